@@ -0,0 +1,180 @@
+// PingPongOS - PingPong Operating System
+
+// Teste da ponte entre threads hospedeiras e tarefas do PPOS: threads
+// POSIX do processo inserem mensagens numeradas numa ponte de um produtor
+// (SPSC) e numa ponte de varios produtores (MPSC); uma tarefa consome cada
+// ponte e confere que as mensagens de cada produtor chegam todas e em
+// ordem; por fim, uma ponte e destruida com o consumidor bloqueado
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include "ppos-bridge.h"
+
+#define NUMMSG   100000  // mensagens por thread produtora
+#define NUMHOST  3       // threads produtoras da ponte MPSC
+#define BATCH    16      // mensagens por bridge_push_n
+
+bridge_t spsc, mpsc ;
+pthread_t host[NUMHOST] ;
+int numHosts ;
+
+// ============================================================================
+
+// Codigo das threads hospedeiras: fica antes de ppos.h, que proibe o uso
+// direto de pthread_create/pthread_join pelas tarefas do PPOS
+
+// thread produtora da ponte SPSC: uma mensagem por vez
+static void *spscHost (void *arg)
+{
+   long i ;
+
+   for (i = 0; i < NUMMSG; )
+      if (bridge_push (&spsc, &i) == 0)
+         i++ ;
+      else
+         sched_yield () ;      // anel cheio
+   return NULL ;
+}
+
+// thread produtora da ponte MPSC: lotes de BATCH mensagens
+static void *mpscHost (void *arg)
+{
+   long msg[BATCH], i, k, n ;
+
+   for (i = 0; i < NUMMSG; i += n)
+   {
+      for (k = 0; k < BATCH && i + k < NUMMSG; k++)
+         msg[k] = (long) arg * NUMMSG + i + k ;
+      n = bridge_push_n (&mpsc, msg, k) ;
+      if (n < k)
+         sched_yield () ;      // anel cheio
+   }
+   return NULL ;
+}
+
+// lanca num threads executando body; os sinais usados pelo PPOS ficam
+// bloqueados nelas (a mascara e herdada da thread criadora)
+static void hostStart (void *(*body) (void *), int num)
+{
+   sigset_t block, old ;
+   long i ;
+
+   sigemptyset (&block) ;
+   sigaddset (&block, SIGALRM) ;
+   sigaddset (&block, SIGUSR1) ;
+   sigaddset (&block, SIGUSR2) ;
+   pthread_sigmask (SIG_BLOCK, &block, &old) ;
+   for (i = 0; i < num; i++)
+      pthread_create (&host[i], NULL, body, (void *) i) ;
+   pthread_sigmask (SIG_SETMASK, &old, NULL) ;
+   numHosts = num ;
+}
+
+// aguarda o fim das threads lancadas por hostStart
+static void hostWait (void)
+{
+   int i ;
+
+   for (i = 0; i < numHosts; i++)
+      pthread_join (host[i], NULL) ;
+   numHosts = 0 ;
+}
+
+// ============================================================================
+
+#include "ppos.h"
+
+task_t cons ;
+int received, outOfOrder, recvResult ;
+
+// consumidor da ponte SPSC
+void spscBody (void * arg)
+{
+   long msg, next = 0 ;
+
+   for (received = 0; received < NUMMSG; received++)
+   {
+      bridge_recv (&spsc, &msg) ;
+      if (msg != next)
+         outOfOrder++ ;
+      next = msg + 1 ;
+   }
+   task_exit (0) ;
+}
+
+// consumidor da ponte MPSC: ordem conferida por produtor
+void mpscBody (void * arg)
+{
+   long msg, next[NUMHOST] = { 0 } ;
+   int p ;
+
+   for (received = 0; received < NUMHOST * NUMMSG; received++)
+   {
+      bridge_recv (&mpsc, &msg) ;
+      p = msg / NUMMSG ;
+      if (p < 0 || p >= NUMHOST || msg % NUMMSG != next[p])
+      {
+         outOfOrder++ ;
+         continue ;
+      }
+      next[p]++ ;
+   }
+   task_exit (0) ;
+}
+
+// consumidor de uma ponte que sera destruida
+void destroyBody (void * arg)
+{
+   long msg ;
+
+   recvResult = bridge_recv (&spsc, &msg) ;
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   printf ("main: inicio\n") ;
+
+   ppos_init () ;
+
+   if (bridge_create (&spsc, 256, sizeof (long), BRIDGE_SPSC) < 0 ||
+       bridge_create (&mpsc, 256, sizeof (long), BRIDGE_MPSC) < 0)
+   {
+      printf ("main: erro na criacao das pontes\n") ;
+      exit (1) ;
+   }
+
+   // um produtor hospedeiro, um consumidor
+   outOfOrder = 0 ;
+   task_create (&cons, spscBody, NULL) ;
+   hostStart (spscHost, 1) ;
+   task_join (&cons) ;
+   hostWait () ;
+   printf ("main: SPSC recebeu %d de %d mensagens, %d fora de ordem\n",
+           received, NUMMSG, outOfOrder) ;
+
+   // varios produtores hospedeiros, um consumidor
+   outOfOrder = 0 ;
+   task_create (&cons, mpscBody, NULL) ;
+   hostStart (mpscHost, NUMHOST) ;
+   task_join (&cons) ;
+   hostWait () ;
+   printf ("main: MPSC recebeu %d de %d mensagens, %d fora de ordem\n",
+           received, NUMHOST * NUMMSG, outOfOrder) ;
+   bridge_destroy (&mpsc) ;
+
+   // destruicao com o consumidor bloqueado na ponte vazia
+   task_create (&cons, destroyBody, NULL) ;
+   task_yield () ;
+   bridge_destroy (&spsc) ;
+   task_join (&cons) ;
+   printf ("main: bridge_recv retornou %d apos bridge_destroy\n", recvResult) ;
+
+   printf ("main: fim\n") ;
+   task_exit (0) ;
+
+   exit (0) ;
+}
@@ -0,0 +1,99 @@
+// PingPongOS - PingPong Operating System
+
+// Teste da politica de escalonamento DISK_SCHED_DEADLINE: varias tarefas
+// leem sem parar blocos proximos ao inicio do disco enquanto outra le um
+// bloco distante. Com SSTF a leitura distante so e atendida quando as
+// leituras proximas acabam; com DEADLINE ela e promovida ao vencer o prazo
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+#include "ppos-disk-manager.h"
+
+#define NUMNEAR   4      // tarefas lendo blocos proximos
+#define NEARREADS 25     // leituras de cada tarefa proxima
+#define FARBLOCK  250    // bloco distante
+#define DEADLINE  200    // prazo das leituras, em ms
+
+int numblocks ;          // numero de blocos no disco
+int blocksize ;          // tamanho de cada bloco (bytes)
+
+task_t near[2][NUMNEAR], far[2] ;
+int nearDone ;           // tarefas proximas ja encerradas
+int farBeforeNear ;      // leitura distante atendida antes do fim das proximas
+int farWait[2] ;         // espera da leitura distante com cada politica, em ms
+
+// le repetidamente blocos proximos ao inicio do disco
+void nearBody (void * arg)
+{
+   unsigned char buffer[64] ;
+   int i ;
+
+   for (i = 0; i < NEARREADS; i++)
+      disk_block_read (((long) arg + i) % 8, buffer) ;
+   nearDone++ ;
+   task_exit (0) ;
+}
+
+// le uma vez o bloco distante, com as leituras proximas em andamento
+void farBody (void * arg)
+{
+   unsigned char buffer[64] ;
+   int start, r = (long) arg ;
+
+   task_yield () ;
+   start = systime () ;
+   disk_block_read (FARBLOCK, buffer) ;
+   farWait[r] = systime () - start ;
+   farBeforeNear = nearDone < NUMNEAR ;
+   task_exit (0) ;
+}
+
+// executa a carga com a politica indicada
+void runPolicy (int r, int policy)
+{
+   disk_t before, after ;
+   long i ;
+
+   disk_set_scheduler (policy) ;
+   disk_mgr_stats (&before) ;
+   nearDone = 0 ;
+   for (i = 0; i < NUMNEAR; i++)
+      task_create (&near[r][i], nearBody, (void *) i) ;
+   task_create (&far[r], farBody, (void *) (long) r) ;
+   for (i = 0; i < NUMNEAR; i++)
+      task_join (&near[r][i]) ;
+   task_join (&far[r]) ;
+   disk_mgr_stats (&after) ;
+
+   printf ("main: %s: leitura distante antes do fim das proximas: %s\n",
+           disk_sched_name (policy), farBeforeNear ? "sim" : "nao") ;
+   printf ("main: %s: houve promocoes por prazo: %s\n",
+           disk_sched_name (policy),
+           after.deadline_promotions > before.deadline_promotions ? "sim" : "nao") ;
+}
+
+int main (int argc, char *argv[])
+{
+   printf ("main: inicio\n") ;
+
+   ppos_init () ;
+
+   // sem cache, todas as leituras vao ao disco
+   disk_set_cache_size (0) ;
+   disk_set_deadline (DEADLINE, 10 * DEADLINE) ;
+   if (disk_mgr_init (&numblocks, &blocksize) < 0)
+   {
+      printf ("Erro na abertura do disco\n") ;
+      exit (1) ;
+   }
+
+   runPolicy (0, DISK_SCHED_SSTF) ;
+   runPolicy (1, DISK_SCHED_DEADLINE) ;
+   printf ("main: leitura distante esperou menos com deadline: %s\n",
+           farWait[1] < farWait[0] ? "sim" : "nao") ;
+
+   // a tarefa gerente de disco nao termina: encerra o processo aqui
+   printf ("main: fim\n") ;
+   exit (0) ;
+}
@@ -0,0 +1,72 @@
+// PingPongOS - PingPong Operating System
+
+// Teste do cache de blocos do gerente de disco (substituicao CLOCK), com
+// uma unica tarefa e sem leitura antecipada: releituras sao atendidas pelo
+// cache, e um conjunto de blocos maior que o cache provoca substituicoes
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ppos.h"
+#include "ppos-disk-manager.h"
+
+#define CACHESIZE 16     // capacidade do cache, em blocos
+
+int numblocks ;          // numero de blocos no disco
+int blocksize ;          // tamanho de cada bloco (bytes)
+
+unsigned char *first, *again ;
+
+// le n blocos a partir de block em buffer e mostra o efeito no cache
+void readPass (char *name, int block, int n, unsigned char *buffer)
+{
+   disk_t before, after ;
+   int i ;
+
+   disk_mgr_stats (&before) ;
+   for (i = 0; i < n; i++)
+      disk_block_read (block + i, buffer + i * blocksize) ;
+   disk_mgr_stats (&after) ;
+
+   printf ("main: %s (blocos %d a %d): %d acertos, %d faltas, %d substituicoes\n",
+           name, block, block + n - 1,
+           after.cache_hits - before.cache_hits,
+           after.cache_misses - before.cache_misses,
+           after.cache_evictions - before.cache_evictions) ;
+}
+
+int main (int argc, char *argv[])
+{
+   unsigned char *scratch ;
+
+   printf ("main: inicio\n") ;
+
+   ppos_init () ;
+
+   disk_set_cache_size (CACHESIZE) ;
+   disk_set_readahead (0) ;
+   if (disk_mgr_init (&numblocks, &blocksize) < 0)
+   {
+      printf ("Erro na abertura do disco\n") ;
+      exit (1) ;
+   }
+
+   first = malloc (8 * blocksize) ;
+   again = malloc (8 * blocksize) ;
+   scratch = malloc (2 * CACHESIZE * blocksize) ;
+
+   readPass ("primeira leitura", 0, 8, first) ;
+   readPass ("releitura", 0, 8, again) ;
+   printf ("main: conteudo da releitura confere: %s\n",
+           memcmp (first, again, 8 * blocksize) ? "nao" : "sim") ;
+
+   // o dobro da capacidade do cache tira dele os blocos lidos antes
+   readPass ("varredura", 16, 2 * CACHESIZE, scratch) ;
+   readPass ("releitura apos varredura", 0, 8, again) ;
+   printf ("main: conteudo da releitura confere: %s\n",
+           memcmp (first, again, 8 * blocksize) ? "nao" : "sim") ;
+
+   // a tarefa gerente de disco nao termina: encerra o processo aqui
+   printf ("main: fim\n") ;
+   exit (0) ;
+}
@@ -0,0 +1,84 @@
+// PingPongOS - PingPong Operating System
+
+// Teste do slab de requisicoes do gerente de disco: varias tarefas fazem
+// acessos simultaneos, fazendo o slab crescer; uma segunda rodada com a
+// mesma carga reaproveita as requisicoes ja alocadas, sem novo crescimento
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+#include "ppos-disk-manager.h"
+
+#define NUMTASKS 40      // tarefas com um acesso pendente cada
+
+int numblocks ;          // numero de blocos no disco
+int blocksize ;          // tamanho de cada bloco (bytes)
+
+task_t task[2][NUMTASKS] ;     // uma rodada de tarefas em cada linha
+unsigned char *buffer[NUMTASKS] ;
+int errors ;
+
+// le o bloco de numero (long) arg
+void readBody (void * arg)
+{
+   long i = (long) arg ;
+
+   if (disk_block_read (i, buffer[i]) < 0)
+      errors++ ;
+   task_exit (0) ;
+}
+
+// regrava no bloco de numero (long) arg o conteudo lido dele
+void writeBody (void * arg)
+{
+   long i = (long) arg ;
+
+   if (disk_block_write (i, buffer[i]) < 0)
+      errors++ ;
+   task_exit (0) ;
+}
+
+// lanca NUMTASKS tarefas executando body e mostra o estado do slab
+void runRound (int r, char *name, void (*body) (void *))
+{
+   disk_t stats ;
+   long i ;
+
+   for (i = 0; i < NUMTASKS; i++)
+      task_create (&task[r][i], body, (void *) i) ;
+   for (i = 0; i < NUMTASKS; i++)
+      task_join (&task[r][i]) ;
+
+   disk_mgr_stats (&stats) ;
+   printf ("main: %s: pico %d pendentes, %d em uso, capacidade %d, %d crescimentos\n",
+           name, stats.req_high_water, stats.req_in_use, stats.req_capacity,
+           stats.req_grows) ;
+}
+
+int main (int argc, char *argv[])
+{
+   long i ;
+
+   printf ("main: inicio\n") ;
+
+   ppos_init () ;
+
+   // sem cache, todo acesso gera uma requisicao ao disco
+   disk_set_cache_size (0) ;
+   if (disk_mgr_init (&numblocks, &blocksize) < 0)
+   {
+      printf ("Erro na abertura do disco\n") ;
+      exit (1) ;
+   }
+
+   for (i = 0; i < NUMTASKS; i++)
+      buffer[i] = malloc (blocksize) ;
+
+   runRound (0, "leituras", readBody) ;
+   runRound (1, "escritas", writeBody) ;
+   printf ("main: %d erros\n", errors) ;
+
+   // a tarefa gerente de disco nao termina: encerra o processo aqui
+   printf ("main: fim\n") ;
+   exit (0) ;
+}
@@ -0,0 +1,115 @@
+// PingPongOS - PingPong Operating System
+
+// Teste da fila de mensagens persistente: varias tarefas enviam mensagens
+// concorrentemente, que sao gravadas em lotes no disco; a fila e depois
+// fechada com mensagens pendentes e reaberta, recuperando-as do log
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+#include "ppos-disk-manager.h"
+#include "ppos-disk-mqueue.h"
+
+#define FIRSTBLOCK 224   // regiao do log: blocos [224, 256)
+#define NUMBLOCKS  32
+#define NUMSEND    4     // tarefas emissoras
+#define NUMMSG     10    // mensagens por emissora
+#define PENDING    5     // mensagens deixadas na fila ao fecha-la
+
+typedef struct
+{
+   int sender ;          // emissora da mensagem
+   int seq ;             // numero de sequencia na emissora
+} msg_t ;
+
+int numblocks ;          // numero de blocos no disco
+int blocksize ;          // tamanho de cada bloco (bytes)
+
+task_t sender[NUMSEND] ;
+dmqueue_t queue ;
+
+// emissora: envia NUMMSG mensagens numeradas
+void senderBody (void * arg)
+{
+   msg_t msg ;
+   int i ;
+
+   for (i = 0; i < NUMMSG; i++)
+   {
+      msg.sender = (long) arg ;
+      msg.seq = i ;
+      dmqueue_send (&queue, &msg) ;
+   }
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   msg_t msg ;
+   int next[NUMSEND] = { 0 } ;
+   int i, received, outOfOrder ;
+
+   printf ("main: inicio\n") ;
+
+   ppos_init () ;
+
+   if (disk_mgr_init (&numblocks, &blocksize) < 0)
+   {
+      printf ("Erro na abertura do disco\n") ;
+      exit (1) ;
+   }
+
+   // uma execucao anterior deste teste deixa a fila vazia
+   i = dmqueue_open (&queue, FIRSTBLOCK, NUMBLOCKS, sizeof (msg_t)) ;
+   if (i < 0)
+   {
+      printf ("main: erro na abertura da fila\n") ;
+      exit (1) ;
+   }
+   printf ("main: fila aberta com %d mensagens\n", i) ;
+
+   // envios concorrentes, recebidos em seguida
+   for (i = 0; i < NUMSEND; i++)
+      task_create (&sender[i], senderBody, (void *) (long) i) ;
+   for (i = 0; i < NUMSEND; i++)
+      task_join (&sender[i]) ;
+
+   received = outOfOrder = 0 ;
+   while (dmqueue_msgs (&queue) > 0)
+   {
+      dmqueue_recv (&queue, &msg) ;
+      if (msg.sender < 0 || msg.sender >= NUMSEND || msg.seq != next[msg.sender])
+         outOfOrder++ ;
+      else
+         next[msg.sender]++ ;
+      received++ ;
+   }
+   printf ("main: %d mensagens recebidas de %d enviadas, %d fora de ordem\n",
+           received, NUMSEND * NUMMSG, outOfOrder) ;
+   printf ("main: envios agrupados em menos gravacoes: %s\n",
+           queue.writes < queue.sends ? "sim" : "nao") ;
+
+   // fecha a fila com mensagens pendentes e a reabre
+   msg.sender = NUMSEND ;
+   for (i = 0; i < PENDING; i++)
+   {
+      msg.seq = i ;
+      dmqueue_send (&queue, &msg) ;
+   }
+   printf ("main: fechando a fila com %d mensagens\n", dmqueue_msgs (&queue)) ;
+   dmqueue_close (&queue) ;
+
+   i = dmqueue_open (&queue, FIRSTBLOCK, NUMBLOCKS, sizeof (msg_t)) ;
+   printf ("main: fila reaberta com %d mensagens:", i) ;
+   while (dmqueue_msgs (&queue) > 0)
+   {
+      dmqueue_recv (&queue, &msg) ;
+      printf (" %d/%d", msg.sender, msg.seq) ;
+   }
+   printf ("\n") ;
+   dmqueue_close (&queue) ;
+
+   // a tarefa gerente de disco nao termina: encerra o processo aqui
+   printf ("main: fim\n") ;
+   exit (0) ;
+}
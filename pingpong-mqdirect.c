@@ -0,0 +1,85 @@
+// PingPongOS - PingPong Operating System
+
+// Teste da entrega direta da fila de mensagens: com receptores bloqueados
+// a mensagem e copiada diretamente para eles, sem passar pelo buffer; sem
+// receptores ela e guardada na fila; uma mensagem enviada enquanto outra
+// reserva esta pendente nao ultrapassa a mensagem reservada antes dela
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+
+task_t recv[3] ;
+mqueue_t queue ;
+
+// receptor: recebe (long) arg mensagens e as mostra
+void recvBody (void * arg)
+{
+   int i, valor ;
+
+   for (i = 0; i < (long) arg; i++)
+   {
+      mqueue_recv (&queue, &valor) ;
+      printf ("T%d recebeu %d\n", task_id(), valor) ;
+   }
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   int valor, *slot ;
+
+   printf ("main: inicio\n") ;
+
+   ppos_init () ;
+
+   if (mqueue_create (&queue, 4, sizeof (int)) < 0)
+   {
+      printf ("main: erro na criacao da fila\n") ;
+      exit (1) ;
+   }
+
+   // dois receptores bloqueiam na fila vazia
+   task_create (&recv[0], recvBody, (void *) 1) ;
+   task_create (&recv[1], recvBody, (void *) 1) ;
+   task_yield () ;
+
+   // cada envio e entregue ao receptor mais antigo, sem ocupar a fila
+   valor = 100 ;
+   mqueue_send (&queue, &valor) ;
+   printf ("main: enviou %d, fila com %d mensagens\n", valor, mqueue_msgs (&queue)) ;
+   valor = 200 ;
+   mqueue_send (&queue, &valor) ;
+   printf ("main: enviou %d, fila com %d mensagens\n", valor, mqueue_msgs (&queue)) ;
+   task_join (&recv[0]) ;
+   task_join (&recv[1]) ;
+
+   // sem receptor bloqueado, a mensagem fica na fila
+   valor = 300 ;
+   mqueue_send (&queue, &valor) ;
+   printf ("main: enviou %d, fila com %d mensagens\n", valor, mqueue_msgs (&queue)) ;
+   mqueue_recv (&queue, &valor) ;
+   printf ("main: recebeu %d da fila\n", valor) ;
+
+   // reserva uma posicao e deixa um receptor bloquear na fila vazia; o
+   // envio seguinte nao pode ser entregue direto, pois passaria a frente
+   // da mensagem reservada antes dele
+   slot = mqueue_reserve (&queue) ;
+   task_create (&recv[2], recvBody, (void *) 2) ;
+   task_yield () ;
+   valor = 2 ;
+   mqueue_send (&queue, &valor) ;
+   printf ("main: enviou %d com reserva pendente\n", valor) ;
+   valor = 1 ;
+   *slot = valor ;
+   mqueue_commit (&queue) ;
+   printf ("main: publicou %d na posicao reservada\n", valor) ;
+   task_join (&recv[2]) ;
+
+   mqueue_destroy (&queue) ;
+
+   printf ("main: fim\n") ;
+   task_exit (0) ;
+
+   exit (0) ;
+}
@@ -0,0 +1,131 @@
+// PingPongOS - PingPong Operating System
+
+// Teste da fila de mensagens em buffer circular: dois produtores enviam
+// muito mais mensagens que a capacidade da fila, de modo que cada posicao
+// do buffer e reutilizada varias vezes; o consumidor confere que as
+// mensagens chegam intactas e, para cada produtor, na ordem de envio
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ppos.h"
+
+#define NUMPROD  2       // produtores
+#define NUMMSG   200     // mensagens enviadas por produtor
+#define CAPACITY 5       // capacidade da fila (mensagens)
+
+typedef struct
+{
+   int prod ;            // produtor que enviou
+   int seq ;             // numero de sequencia no produtor
+   char text[16] ;       // texto derivado de (prod, seq)
+} msg_t ;
+
+task_t prod[NUMPROD], cons ;
+mqueue_t queue ;
+int received, outOfOrder, corrupted ;
+
+// produtor: envia NUMMSG mensagens numeradas
+void prodBody (void * arg)
+{
+   msg_t msg ;
+   int i ;
+
+   for (i = 0; i < NUMMSG; i++)
+   {
+      msg.prod = (long) arg ;
+      msg.seq = i ;
+      snprintf (msg.text, sizeof (msg.text), "p%d m%d", msg.prod, i) ;
+      mqueue_send (&queue, &msg) ;
+   }
+   task_exit (0) ;
+}
+
+// consumidor: recebe todas as mensagens e confere ordem e conteudo
+void consBody (void * arg)
+{
+   msg_t msg ;
+   char text[16] ;
+   int next[NUMPROD] = { 0 } ;
+
+   while (received < NUMPROD * NUMMSG)
+   {
+      mqueue_recv (&queue, &msg) ;
+      snprintf (text, sizeof (text), "p%d m%d", msg.prod, msg.seq) ;
+      if (msg.prod < 0 || msg.prod >= NUMPROD || strcmp (text, msg.text))
+      {
+         corrupted++ ;
+         continue ;
+      }
+      if (msg.seq != next[msg.prod])
+         outOfOrder++ ;
+      next[msg.prod] = msg.seq + 1 ;
+      received++ ;
+   }
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   msg_t msg ;
+   const msg_t *first ;
+   long i ;
+
+   printf ("main: inicio\n") ;
+
+   ppos_init () ;
+
+   if (mqueue_create (&queue, CAPACITY, sizeof (msg_t)) < 0)
+   {
+      printf ("main: erro na criacao da fila\n") ;
+      exit (1) ;
+   }
+
+   // preenche a fila, esvazia parte dela e volta a enche-la: as novas
+   // mensagens ocupam as posicoes liberadas no inicio do buffer
+   for (i = 0; i < CAPACITY; i++)
+   {
+      msg.prod = 0 ;
+      msg.seq = i ;
+      mqueue_send (&queue, &msg) ;
+   }
+   mqueue_recv (&queue, &msg) ;
+   mqueue_recv (&queue, &msg) ;
+   for (i = CAPACITY; i < CAPACITY + 2; i++)
+   {
+      msg.seq = i ;
+      mqueue_send (&queue, &msg) ;
+   }
+   printf ("main: fila cheia com %d mensagens\n", mqueue_msgs (&queue)) ;
+   first = mqueue_peek (&queue) ;
+   printf ("main: consumiu sem copia a mensagem %d\n", first->seq) ;
+   mqueue_release (&queue) ;
+   printf ("main: ordem apos dar a volta no buffer:") ;
+   while (mqueue_msgs (&queue) > 0)
+   {
+      mqueue_recv (&queue, &msg) ;
+      printf (" %d", msg.seq) ;
+   }
+   printf ("\n") ;
+
+   // produtores e consumidor concorrentes sobre a fila pequena
+   for (i = 0; i < NUMPROD; i++)
+      task_create (&prod[i], prodBody, (void *) i) ;
+   task_create (&cons, consBody, NULL) ;
+
+   for (i = 0; i < NUMPROD; i++)
+      task_join (&prod[i]) ;
+   task_join (&cons) ;
+
+   printf ("main: %d mensagens recebidas de %d enviadas\n",
+           received, NUMPROD * NUMMSG) ;
+   printf ("main: %d fora de ordem, %d corrompidas, %d na fila\n",
+           outOfOrder, corrupted, mqueue_msgs (&queue)) ;
+
+   mqueue_destroy (&queue) ;
+
+   printf ("main: fim\n") ;
+   task_exit (0) ;
+
+   exit (0) ;
+}
@@ -0,0 +1,82 @@
+// PingPongOS - PingPong Operating System
+
+// Teste da leitura antecipada do gerente de disco: uma tarefa le e processa
+// blocos em sequencia, primeiro sem e depois com leitura antecipada; com
+// ela, os proximos blocos sao lidos do disco enquanto a tarefa processa o
+// bloco corrente, e a passada termina antes
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ppos.h"
+#include "ppos-disk-manager.h"
+
+#define NUMREAD 32       // blocos lidos em cada passada (= capacidade do cache)
+#define WINDOW  16       // janela da leitura antecipada, em blocos
+#define PROCESS 20       // processamento de cada bloco lido, em ms
+
+int numblocks ;          // numero de blocos no disco
+int blocksize ;          // tamanho de cada bloco (bytes)
+
+// le e processa NUMREAD blocos em sequencia a partir de block; devolve a
+// duracao da passada
+int readPass (int block, unsigned char *buffer, disk_t *before, disk_t *after)
+{
+   int i, start, now ;
+
+   disk_mgr_stats (before) ;
+   start = systime () ;
+   for (i = 0; i < NUMREAD; i++)
+   {
+      disk_block_read (block + i, buffer + i * blocksize) ;
+      for (now = systime (); systime () < now + PROCESS; ) ;
+   }
+   disk_mgr_stats (after) ;
+   return systime () - start ;
+}
+
+int main (int argc, char *argv[])
+{
+   unsigned char *expected, *buffer ;
+   disk_t before, after ;
+   int plain, ahead ;
+
+   printf ("main: inicio\n") ;
+
+   ppos_init () ;
+
+   disk_set_cache_size (NUMREAD) ;
+   disk_set_readahead (0) ;
+   if (disk_mgr_init (&numblocks, &blocksize) < 0)
+   {
+      printf ("Erro na abertura do disco\n") ;
+      exit (1) ;
+   }
+
+   expected = malloc (NUMREAD * blocksize) ;
+   buffer = malloc (NUMREAD * blocksize) ;
+
+   // conteudo de referencia dos blocos 128 a 159, lido sem antecipacao;
+   // a passada seguinte ocupa todo o cache e os tira dele
+   readPass (128, expected, &before, &after) ;
+   plain = readPass (64, buffer, &before, &after) ;
+   printf ("main: sem antecipacao: %d faltas em %d leituras, %d blocos antecipados\n",
+           after.cache_misses - before.cache_misses, NUMREAD,
+           after.ra_issued - before.ra_issued) ;
+
+   disk_set_readahead (WINDOW) ;
+   ahead = readPass (128, buffer, &before, &after) ;
+   printf ("main: com antecipacao: blocos antecipados: %s, leituras atendidas por eles: %s\n",
+           after.ra_issued > before.ra_issued ? "sim" : "nao",
+           after.ra_hits > before.ra_hits ? "sim" : "nao") ;
+   printf ("main: com antecipacao: menos faltas que leituras: %s\n",
+           after.cache_misses - before.cache_misses < NUMREAD ? "sim" : "nao") ;
+   printf ("main: com antecipacao: conteudo confere: %s\n",
+           memcmp (expected, buffer, NUMREAD * blocksize) ? "nao" : "sim") ;
+   printf ("main: leitura sequencial mais rapida com antecipacao: %s\n",
+           ahead < plain ? "sim" : "nao") ;
+
+   // a tarefa gerente de disco nao termina: encerra o processo aqui
+   printf ("main: fim\n") ;
+   exit (0) ;
+}
@@ -0,0 +1,116 @@
+// PingPongOS - PingPong Operating System
+
+// Teste dos topicos publica/assina: cada mensagem publicada e recebida por
+// todos os assinantes; com TOPIC_DROP_OLDEST o anel cheio descarta a
+// mensagem mais antiga so para quem ainda nao a leu; cancelar a assinatura
+// de uma tarefa bloqueada em topic_peek a acorda
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "ppos.h"
+
+#define NUMSUBS 3        // assinantes do primeiro teste
+#define NUMMSG  50       // mensagens publicadas no primeiro teste
+
+task_t subTask[NUMSUBS], peekTask ;
+topic_t topic ;
+topic_sub_t sub[NUMSUBS] ;
+int received[NUMSUBS], outOfOrder[NUMSUBS] ;
+const void *peeked ;
+
+// assinante: recebe NUMMSG mensagens e confere a ordem
+void subBody (void * arg)
+{
+   long i = (long) arg ;
+   int msg, next ;
+
+   for (next = 0; next < NUMMSG; next++)
+   {
+      if (topic_recv (&sub[i], &msg) < 0)
+         break ;
+      if (msg != next)
+         outOfOrder[i]++ ;
+      received[i]++ ;
+   }
+   task_exit (0) ;
+}
+
+// aguarda em topic_peek ate a assinatura ser cancelada por main
+void peekBody (void * arg)
+{
+   peeked = topic_peek (&sub[0]) ;
+   task_exit (0) ;
+}
+
+int main (int argc, char *argv[])
+{
+   const int *slot ;
+   int msg ;
+   long i ;
+
+   printf ("main: inicio\n") ;
+
+   ppos_init () ;
+
+   // varios assinantes lendo de um anel menor que o numero de mensagens
+   topic_create (&topic, 4, sizeof (int), TOPIC_BLOCK) ;
+   for (i = 0; i < NUMSUBS; i++)
+   {
+      topic_subscribe (&topic, &sub[i]) ;
+      task_create (&subTask[i], subBody, (void *) i) ;
+   }
+   for (msg = 0; msg < NUMMSG; msg++)
+      topic_publish (&topic, &msg) ;
+   for (i = 0; i < NUMSUBS; i++)
+   {
+      task_join (&subTask[i]) ;
+      printf ("main: assinante %ld recebeu %d de %d mensagens, %d fora de ordem\n",
+              i, received[i], NUMMSG, outOfOrder[i]) ;
+   }
+   topic_destroy (&topic) ;
+
+   // anel de 2 posicoes: A nao le nada; B le a mensagem 0 e empresta a 1;
+   // a publicacao seguinte descarta a mensagem 0 so para A (B assina antes,
+   // para que A seja visitado primeiro na lista de assinantes)
+   topic_create (&topic, 2, sizeof (int), TOPIC_DROP_OLDEST) ;
+   topic_subscribe (&topic, &sub[1]) ;
+   topic_subscribe (&topic, &sub[0]) ;
+   for (msg = 0; msg < 2; msg++)
+      topic_publish (&topic, &msg) ;
+   topic_recv (&sub[1], &msg) ;
+   slot = topic_peek (&sub[1]) ;
+   msg = 2 ;
+   topic_publish (&topic, &msg) ;
+   printf ("main: A descartou %lu, cursor %lu\n", sub[0].dropped, sub[0].cursor) ;
+   printf ("main: B descartou %lu, cursor %lu, emprestada %d (mensagem %d)\n",
+           sub[1].dropped, sub[1].cursor, sub[1].borrowed, *slot) ;
+   topic_release (&sub[1]) ;
+   printf ("main: A le:") ;
+   while (sub[0].cursor < topic.tail)
+   {
+      topic_recv (&sub[0], &msg) ;
+      printf (" %d", msg) ;
+   }
+   printf ("\nmain: B le:") ;
+   while (sub[1].cursor < topic.tail)
+   {
+      topic_recv (&sub[1], &msg) ;
+      printf (" %d", msg) ;
+   }
+   printf ("\n") ;
+
+   // cancelamento da assinatura de uma tarefa bloqueada em topic_peek
+   task_create (&peekTask, peekBody, NULL) ;
+   task_yield () ;
+   topic_unsubscribe (&sub[0]) ;
+   task_join (&peekTask) ;
+   printf ("main: topic_peek apos cancelar a assinatura: %s\n",
+           peeked == NULL ? "NULL" : "mensagem") ;
+   topic_unsubscribe (&sub[1]) ;
+   topic_destroy (&topic) ;
+
+   printf ("main: fim\n") ;
+   task_exit (0) ;
+
+   exit (0) ;
+}
@@ -0,0 +1,307 @@
+#include "ppos.h"
+#include "ppos-core-globals.h"
+#include "ppos-bridge.h"
+
+#include <limits.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+/* ============================================================
+ * Variaveis Globais da Ponte
+   ============================================================
+ */
+
+// pontes ativas, percorridas pelo tratador do sinal
+static bridge_t *bridge_list = NULL;
+
+// thread do processo que executa o PPOS, destino dos sinais de despertar
+static pid_t bridge_pid;
+static pid_t bridge_tid;
+static int bridge_sig_installed = 0;
+
+/* ============================================================
+ * Despertar do Consumidor
+   ============================================================
+ */
+
+// executa na thread do PPOS; so altera o despertar da tarefa estacionada,
+// que o dispatcher acorda na proxima passada pela fila de tarefas dormindo
+static void bridge_signal_handler(int signum) {
+    (void) signum;
+    for (bridge_t *bridge = bridge_list; bridge != NULL; bridge = bridge->nextBridge) {
+        task_t *waiter = bridge->waiter;
+        if (waiter != NULL)
+            waiter->awakeTime = 0;
+    }
+}
+
+static int setup_bridge_signal_handler(void) {
+    struct sigaction action;
+
+    if (bridge_sig_installed)
+        return 0;
+    action.sa_handler = bridge_signal_handler;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = SA_RESTART;
+    if (sigaction(SIGUSR2, &action, NULL) < 0)
+        return -1;
+    bridge_pid = getpid();
+    bridge_tid = syscall(SYS_gettid);
+    bridge_sig_installed = 1;
+    return 0;
+}
+
+// bloqueia SIGUSR2 enquanto a lista de pontes e alterada: o tratador nao
+// pode percorre-la com um elo pela metade
+static void bridge_list_lock(sigset_t *old) {
+    sigset_t set;
+
+    sigemptyset(&set);
+    sigaddset(&set, SIGUSR2);
+    sigprocmask(SIG_BLOCK, &set, old);
+}
+
+static void bridge_list_unlock(sigset_t *old) {
+    sigprocmask(SIG_SETMASK, old, NULL);
+}
+
+// chamada pelo produtor apos publicar um lote: sinaliza a thread do PPOS
+// somente se o consumidor estiver estacionado, no maximo uma vez por lote
+static void bridge_notify(bridge_t *bridge) {
+    atomic_thread_fence(memory_order_seq_cst);
+    if (atomic_exchange(&bridge->parked, 0)) {
+        atomic_fetch_add_explicit(&bridge->signals, 1, memory_order_relaxed);
+        syscall(SYS_tgkill, bridge_pid, bridge_tid, SIGUSR2);
+    }
+}
+
+/* ============================================================
+ * Criacao e Destruicao
+   ============================================================
+ */
+
+int bridge_create(bridge_t *bridge, int max, int size, int mode) {
+    unsigned long capacity = 1;
+    sigset_t mask;
+
+    if (bridge == NULL || max <= 0 || size <= 0 ||
+        (mode != BRIDGE_SPSC && mode != BRIDGE_MPSC))
+        return -1;
+    while (capacity < (unsigned long) max)
+        capacity <<= 1;
+
+    bridge->content = malloc(capacity * size);
+    bridge->seq = NULL;
+    if (mode == BRIDGE_MPSC)
+        bridge->seq = malloc(capacity * sizeof(atomic_ulong));
+    if (bridge->content == NULL || (mode == BRIDGE_MPSC && bridge->seq == NULL)) {
+        free(bridge->content);
+        free(bridge->seq);
+        return -1;
+    }
+    if (mode == BRIDGE_MPSC) {
+        for (unsigned long i = 0; i < capacity; i++)
+            atomic_init(&bridge->seq[i], i);
+    }
+    bridge->messageSize = size;
+    bridge->mask = capacity - 1;
+    bridge->mode = mode;
+    atomic_init(&bridge->tail, 0);
+    atomic_init(&bridge->head, 0);
+    atomic_init(&bridge->signals, 0);
+    atomic_init(&bridge->parked, 0);
+    bridge->headCache = 0;
+    bridge->waiter = NULL;
+
+    PPOS_PREEMPT_DISABLE;
+    if (setup_bridge_signal_handler() < 0) {
+        PPOS_PREEMPT_ENABLE;
+        free(bridge->content);
+        free(bridge->seq);
+        return -1;
+    }
+    bridge->active = 1;
+    bridge_list_lock(&mask);
+    bridge->nextBridge = bridge_list;
+    bridge_list = bridge;
+    bridge_list_unlock(&mask);
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
+int bridge_destroy(bridge_t *bridge) {
+    bridge_t **link;
+    sigset_t mask;
+
+    if (bridge == NULL || !bridge->active)
+        return -1;
+
+    PPOS_PREEMPT_DISABLE;
+    bridge->active = 0;
+    // o consumidor estacionado acorda e encontra a ponte destruida, sem
+    // voltar a consultar o anel
+    if (bridge->waiter != NULL)
+        bridge->waiter->awakeTime = 0;
+    bridge_list_lock(&mask);
+    for (link = &bridge_list; *link != NULL; link = &(*link)->nextBridge) {
+        if (*link == bridge) {
+            *link = bridge->nextBridge;
+            break;
+        }
+    }
+    bridge_list_unlock(&mask);
+    free(bridge->content);
+    free(bridge->seq);
+    bridge->content = NULL;
+    bridge->seq = NULL;
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
+/* ============================================================
+ * Insercao (threads hospedeiras)
+   ============================================================
+ */
+
+// insere ate n mensagens em uma ponte com um unico produtor: copia todas as
+// que cabem e publica o lote com uma unica escrita em tail
+static int bridge_push_spsc(bridge_t *bridge, const unsigned char *msg, int n) {
+    unsigned long tail = atomic_load_explicit(&bridge->tail, memory_order_relaxed);
+    unsigned long capacity = bridge->mask + 1;
+    unsigned long room = capacity - (tail - bridge->headCache);
+    int i;
+
+    if (room < (unsigned long) n) {
+        bridge->headCache = atomic_load_explicit(&bridge->head, memory_order_acquire);
+        room = capacity - (tail - bridge->headCache);
+    }
+    if ((unsigned long) n > room)
+        n = room;
+    for (i = 0; i < n; i++) {
+        memcpy(bridge->content + ((tail + i) & bridge->mask) * bridge->messageSize,
+               msg, bridge->messageSize);
+        msg += bridge->messageSize;
+    }
+    if (n > 0)
+        atomic_store_explicit(&bridge->tail, tail + n, memory_order_release);
+    return n;
+}
+
+// insere ate n mensagens em uma ponte com varios produtores; cada posicao
+// e reservada com CAS em tail e publicada pela sua sequencia
+static int bridge_push_mpsc(bridge_t *bridge, const unsigned char *msg, int n) {
+    int pushed = 0;
+
+    while (pushed < n) {
+        unsigned long pos = atomic_load_explicit(&bridge->tail, memory_order_relaxed);
+        for (;;) {
+            unsigned long seq = atomic_load_explicit(&bridge->seq[pos & bridge->mask],
+                                                     memory_order_acquire);
+            long diff = (long) (seq - pos);
+            if (diff == 0) {
+                if (atomic_compare_exchange_weak_explicit(&bridge->tail, &pos, pos + 1,
+                                                          memory_order_relaxed,
+                                                          memory_order_relaxed))
+                    break;
+            } else if (diff < 0) {
+                return pushed;  // anel cheio
+            } else {
+                pos = atomic_load_explicit(&bridge->tail, memory_order_relaxed);
+            }
+        }
+        memcpy(bridge->content + (pos & bridge->mask) * bridge->messageSize,
+               msg, bridge->messageSize);
+        atomic_store_explicit(&bridge->seq[pos & bridge->mask], pos + 1, memory_order_release);
+        msg += bridge->messageSize;
+        pushed++;
+    }
+    return pushed;
+}
+
+int bridge_push_n(bridge_t *bridge, const void *msgs, int n) {
+    int pushed;
+
+    if (bridge == NULL || !bridge->active || msgs == NULL || n <= 0)
+        return 0;
+    if (bridge->mode == BRIDGE_SPSC)
+        pushed = bridge_push_spsc(bridge, msgs, n);
+    else
+        pushed = bridge_push_mpsc(bridge, msgs, n);
+    if (pushed > 0)
+        bridge_notify(bridge);
+    return pushed;
+}
+
+int bridge_push(bridge_t *bridge, const void *msg) {
+    return bridge_push_n(bridge, msg, 1) == 1 ? 0 : -1;
+}
+
+/* ============================================================
+ * Recepcao (tarefas do PPOS)
+   ============================================================
+ */
+
+// retira a mensagem mais antiga, se houver; retorna 1 se retirou
+static int bridge_take(bridge_t *bridge, void *msg) {
+    unsigned long head = atomic_load_explicit(&bridge->head, memory_order_relaxed);
+    unsigned char *slot = bridge->content + (head & bridge->mask) * bridge->messageSize;
+
+    if (bridge->mode == BRIDGE_SPSC) {
+        if (head == atomic_load_explicit(&bridge->tail, memory_order_acquire))
+            return 0;
+        memcpy(msg, slot, bridge->messageSize);
+        atomic_store_explicit(&bridge->head, head + 1, memory_order_release);
+    } else {
+        atomic_ulong *seq = &bridge->seq[head & bridge->mask];
+        if (atomic_load_explicit(seq, memory_order_acquire) != head + 1)
+            return 0;
+        memcpy(msg, slot, bridge->messageSize);
+        atomic_store_explicit(seq, head + bridge->mask + 1, memory_order_release);
+        atomic_store_explicit(&bridge->head, head + 1, memory_order_relaxed);
+    }
+    return 1;
+}
+
+// ha mensagem publicada esperando o consumidor?
+static int bridge_ready(bridge_t *bridge) {
+    unsigned long head = atomic_load_explicit(&bridge->head, memory_order_relaxed);
+
+    if (bridge->mode == BRIDGE_SPSC)
+        return head != atomic_load_explicit(&bridge->tail, memory_order_acquire);
+    return atomic_load_explicit(&bridge->seq[head & bridge->mask], memory_order_acquire) == head + 1;
+}
+
+int bridge_recv(bridge_t *bridge, void *msg) {
+    if (bridge == NULL || !bridge->active || msg == NULL)
+        return -1;
+
+    // sem preempcao, bridge_destroy nao libera o anel durante a retirada
+    PPOS_PREEMPT_DISABLE;
+    while (bridge->active) {
+        if (bridge_take(bridge, msg)) {
+            PPOS_PREEMPT_ENABLE;
+            return 0;
+        }
+
+        // estaciona na fila de tarefas dormindo ate o sinal do produtor;
+        // o anel e reconsultado apos anunciar a espera, para nao perder
+        // um lote publicado nesse meio tempo
+        bridge->waiter = taskExec;
+        taskExec->awakeTime = UINT_MAX;
+        atomic_store(&bridge->parked, 1);
+        atomic_thread_fence(memory_order_seq_cst);
+        if (!bridge_ready(bridge)) {
+            task_suspend(taskExec, &sleepQueue);
+            PPOS_PREEMPT_ENABLE;
+            task_yield();
+            PPOS_PREEMPT_DISABLE;
+        }
+        atomic_store(&bridge->parked, 0);
+        bridge->waiter = NULL;
+    }
+    PPOS_PREEMPT_ENABLE;
+    return -1;
+}
@@ -0,0 +1,71 @@
+// PingPongOS - PingPong Operating System
+
+// interface da ponte entre threads do processo hospedeiro e tarefas do PPOS
+
+#ifndef __PPOS_BRIDGE__
+#define __PPOS_BRIDGE__
+
+#include <stdatomic.h>
+
+// Uma ponte e um anel de mensagens de tamanho fixo sem travas: as threads
+// hospedeiras (fora do PPOS) inserem com bridge_push/bridge_push_n usando
+// apenas operacoes atomicas C11, e uma tarefa do PPOS consome com
+// bridge_recv, que bloqueia enquanto o anel estiver vazio.
+//
+// A tarefa bloqueada fica na fila de tarefas dormindo do nucleo, com
+// despertar "infinito". O produtor que encontra a tarefa estacionada envia
+// um unico sinal SIGUSR2 por lote a thread do PPOS; o tratador apenas zera
+// o despertar da tarefa, que e acordada pelo dispatcher (o tratador nao
+// mexe em filas do nucleo). As threads hospedeiras devem bloquear os sinais
+// usados pelo PPOS (SIGALRM do temporizador, SIGUSR1 do disco e SIGUSR2),
+// para que eles sejam sempre tratados pela thread do PPOS.
+
+#define BRIDGE_SPSC 0               // um unico produtor
+#define BRIDGE_MPSC 1               // varios produtores
+
+#define BRIDGE_CACHELINE 64
+
+// estrutura que define uma ponte
+typedef struct bridge_t {
+    // dados constantes apos bridge_create
+    unsigned char *content;
+    int messageSize;
+    unsigned long mask;             // capacidade - 1 (capacidade potencia de 2)
+    int mode;                       // BRIDGE_SPSC ou BRIDGE_MPSC
+    atomic_ulong *seq;              // BRIDGE_MPSC: sequencia de cada posicao
+    struct bridge_t *nextBridge;    // lista de pontes vista pelo tratador do sinal
+
+    // lado dos produtores
+    _Alignas(BRIDGE_CACHELINE) atomic_ulong tail;
+    unsigned long headCache;        // BRIDGE_SPSC: ultimo head lido pelo produtor
+    atomic_ulong signals;           // sinais enviados (um por lote no maximo)
+
+    // lado do consumidor
+    _Alignas(BRIDGE_CACHELINE) atomic_ulong head;
+    atomic_int parked;              // consumidor estacionado aguardando sinal
+    struct task_t *waiter;          // tarefa estacionada em bridge_recv
+    unsigned char active;
+} bridge_t;
+
+// cria uma ponte para ate max mensagens de size bytes (max e arredondado
+// para a proxima potencia de 2); deve ser chamada por uma tarefa do PPOS
+int bridge_create(bridge_t *bridge, int max, int size, int mode);
+
+// insere uma mensagem (chamada por uma thread hospedeira, nao bloqueia);
+// retorna 0 ou -1 se o anel estiver cheio
+int bridge_push(bridge_t *bridge, const void *msg);
+
+// insere ate n mensagens consecutivas de msgs com um unico despertar do
+// consumidor (chamada por uma thread hospedeira, nao bloqueia); retorna o
+// numero de mensagens inseridas
+int bridge_push_n(bridge_t *bridge, const void *msgs, int n);
+
+// recebe uma mensagem, bloqueando a tarefa enquanto o anel estiver vazio
+int bridge_recv(bridge_t *bridge, void *msg);
+
+// destroi a ponte, liberando o anel; a tarefa bloqueada em bridge_recv
+// retorna -1. Nao deve haver produtores ativos: nenhuma thread hospedeira
+// pode chamar bridge_push/bridge_push_n durante ou apos a destruicao
+int bridge_destroy(bridge_t *bridge);
+
+#endif
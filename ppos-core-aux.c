@@ -2,13 +2,150 @@
 #include "ppos-core-globals.h"
 #include "ppos-disk-manager.h"
 
+#include <signal.h>
+#include <string.h>
+
 #define DEBUG_SEM 1
 
+// estados de tarefa como gravados pelo nucleo (ppos-all.o), que usa
+// letras minusculas em vez dos PPOS_TASK_STATE_* de ppos.h
+#define CORE_TASK_STATE_READY     'r'
+#define CORE_TASK_STATE_SUSPENDED 's'
+
+
+// taskMain e taskDisp sao alocadas dentro do ppos-all.o com o task_t original,
+// sem os campos estendidos de ppos-data.h; escrever nesses campos corromperia
+// as variaveis globais do nucleo alocadas logo apos esses descritores
+#define TASK_HAS_EXT_FIELDS(task) ((task) != taskMain && (task) != taskDisp)
+
 
 // ****************************************************************************
 // Coloque as suas modificações aqui, 
 // p.ex. includes, defines variáveis, // estruturas e funções
 
+// prioridade e dados de espera da tarefa main (ver TASK_HAS_EXT_FIELDS)
+static int mainPrio = 0;
+static void* mainWaitData = NULL;
+
+// contabilidade de tempo de main e do dispatcher (ver TASK_HAS_EXT_FIELDS);
+// as duas sao criadas por ppos_init, no instante 0
+static int mainRunningTime = 0, dispRunningTime = 0;
+static unsigned int mainActivations = 0, dispActivations = 0;
+static int mainLaunchTimestamp = 0, dispLaunchTimestamp = 0;
+
+// instante em que a tarefa corrente recebeu o processador
+static int lastSwitchTime = 0;
+
+// enderecos dos campos de contabilidade de uma tarefa
+static void task_acct(task_t* task, int** running_time, int** launch_timestamp,
+                      unsigned int** activations) {
+    if (TASK_HAS_EXT_FIELDS(task)) {
+        *running_time = &(task->running_time);
+        *launch_timestamp = &(task->launch_timestamp);
+        *activations = &(task->activations);
+    } else if (task == taskMain) {
+        *running_time = &mainRunningTime;
+        *launch_timestamp = &mainLaunchTimestamp;
+        *activations = &mainActivations;
+    } else {
+        *running_time = &dispRunningTime;
+        *launch_timestamp = &dispLaunchTimestamp;
+        *activations = &dispActivations;
+    }
+}
+
+// registra/consulta os dados da espera em curso de uma tarefa bloqueada
+static void task_set_wait_data(task_t* task, void* data) {
+    if (TASK_HAS_EXT_FIELDS(task)) {
+        task->wait_data = data;
+    } else {
+        mainWaitData = data;
+    }
+}
+
+static void* task_get_wait_data(task_t* task) {
+    return TASK_HAS_EXT_FIELDS(task) ? task->wait_data : mainWaitData;
+}
+
+// define a prioridade estatica de uma tarefa (ou da tarefa atual)
+void task_setprio(task_t* task, int prio) {
+    if (task == NULL) {
+        task = taskExec;
+    }
+    if (prio < PPOS_PRIO_MAX) {
+        prio = PPOS_PRIO_MAX;
+    } else if (prio > PPOS_PRIO_MIN) {
+        prio = PPOS_PRIO_MIN;
+    }
+    if (TASK_HAS_EXT_FIELDS(task)) {
+        task->prio = prio;
+    } else if (task == taskMain) {
+        mainPrio = prio;
+    }
+}
+
+// retorna a prioridade estatica de uma tarefa (ou da tarefa atual)
+int task_getprio(task_t* task) {
+    if (task == NULL) {
+        task = taskExec;
+    }
+    if (TASK_HAS_EXT_FIELDS(task)) {
+        return task->prio;
+    }
+    return (task == taskMain) ? mainPrio : 0;
+}
+
+// reposiciona a tarefa, recem-inserida no final da fila por task_suspend,
+// logo apos a ultima tarefa de prioridade igual ou maior que a sua; o
+// nivel de destino vem do mapa de bits do indice, sem percorrer a fila
+static void wait_index_insert(task_t** queue, waitindex_t* index, task_t* task) {
+    int level = task_getprio(task) - PPOS_PRIO_MAX;
+    unsigned long long upTo = index->levels & ((2ULL << level) - 1);
+
+    if (upTo == 0) {
+        // nenhuma tarefa tao prioritaria: como a fila e circular e a tarefa
+        // esta no final, basta torna-la a cabeca da fila
+        *queue = task;
+    } else {
+        task_t *after = index->tail[63 - __builtin_clzll(upTo)];
+        if (after != task->prev) {
+            task->prev->next = task->next;
+            task->next->prev = task->prev;
+            task->prev = after;
+            task->next = after->next;
+            after->next->prev = task;
+            after->next = task;
+        }
+    }
+    index->tail[level] = task;
+    index->levels |= 1ULL << level;
+}
+
+// atualiza o indice antes de a tarefa deixar a fila de espera
+static void wait_index_remove(task_t* queue, waitindex_t* index, task_t* task) {
+    unsigned long long bits = index->levels;
+    while (bits) {
+        int level = __builtin_ctzll(bits);
+        bits &= bits - 1;
+        if (index->tail[level] != task) {
+            continue;
+        }
+        // se a anterior for do mesmo nivel, ela passa a ser a ultima dele
+        int prevSameLevel = (task != queue);
+        for (unsigned long long other = index->levels; other && prevSameLevel; other &= other - 1) {
+            if (index->tail[__builtin_ctzll(other)] == task->prev) {
+                prevSameLevel = 0;
+            }
+        }
+        if (prevSameLevel) {
+            index->tail[level] = task->prev;
+        } else {
+            index->levels &= ~(1ULL << level);
+        }
+        return;
+    }
+}
+
 
 
 void before_ppos_init () {
@@ -35,6 +172,12 @@ void before_task_create (task_t *task ) {
 
 void after_task_create (task_t *task ) {
     // put your customization here
+    if (TASK_HAS_EXT_FIELDS(task)) {
+        task->prio = 0;
+        task->launch_timestamp = systime();
+        task->running_time = 0;
+        task->activations = 0;
+    }
 #ifdef DEBUG
     printf("\ntask_create - AFTER - [%d]", task->id);
 #endif
@@ -43,6 +186,15 @@ void after_task_create (task_t *task ) {
 
 void before_task_exit () {
     // put your customization here
+    // o nucleo libera o contador de quantum da tarefa (custom_data) antes de
+    // trocar de contexto, e o tratador de ticks o decrementa mesmo com a
+    // preempcao desligada: um tick nesse intervalo escreveria em memoria ja
+    // liberada, corrompendo o heap. O SIGALRM fica bloqueado ate a troca de
+    // contexto, que restaura a mascara de sinais da proxima tarefa
+    sigset_t alarm;
+    sigemptyset(&alarm);
+    sigaddset(&alarm, SIGALRM);
+    sigprocmask(SIG_BLOCK, &alarm, NULL);
 #ifdef DEBUG
     printf("\ntask_exit - BEFORE - [%d]", taskExec->id);
 #endif
@@ -50,17 +202,34 @@ void before_task_exit () {
 
 void after_task_exit () {
     // put your customization here
+    // o nucleo ja reabilitou a preempcao e marcou a tarefa como encerrada;
+    // se ela fosse preemptada durante o printf, o dispatcher a escalonaria
+    // de novo e ela deixaria de constar como encerrada para task_join
+    int *running_time, *launch_timestamp;
+    unsigned int *activations;
+    PPOS_PREEMPT_DISABLE;
+    task_acct(taskExec, &running_time, &launch_timestamp, &activations);
     printf("Task %d exit: execution time %d ms, processor time: %d ms, %d activations\n", 
-        taskExec->id,systime() - taskExec->launch_timestamp, 
-        taskExec->running_time,
-        taskExec->activations);
+        taskExec->id, systime() - *launch_timestamp,
+        *running_time + systime() - lastSwitchTime,
+        *activations);
 #ifdef DEBUG
     printf("\ntask_exit - AFTER- [%d]", taskExec->id);
 #endif 
+    PPOS_PREEMPT_ENABLE;
 }
 
 void before_task_switch ( task_t *task ) {
     // put your customization here
+    // taskExec ainda e a tarefa que perde o processador
+    int *running_time, *launch_timestamp;
+    unsigned int *activations;
+    int now = systime();
+    task_acct(taskExec, &running_time, &launch_timestamp, &activations);
+    *running_time += now - lastSwitchTime;
+    task_acct(task, &running_time, &launch_timestamp, &activations);
+    (*activations)++;
+    lastSwitchTime = now;
 #ifdef DEBUG
     printf("\ntask_switch - BEFORE - [%d -> %d]", taskExec->id, task->id);
 #endif
@@ -146,6 +315,51 @@ int after_task_join (task_t *task) {
     return 0;
 }
 
+// registro de espera de uma tarefa bloqueada em um semáforo; fica na pilha
+// da propria tarefa e e acessado via task_get_wait_data()
+typedef struct {
+    int units;                      // unidades requisitadas (sem_down_n)
+    void* msg;                      // destino de um mqueue_recv, para entrega direta
+    unsigned char delivered;        // mensagem ja copiada em msg pelo emissor
+} semwait_t;
+
+// registro de uma tarefa em ppos_wait_any na lista de um semáforo; fica na
+// pilha da tarefa que aguarda
+typedef struct semwatch_t {
+    struct semwatch_t *prev, *next;
+    semaphore_t* sem;               // semaforo observado (NULL: destruido)
+    task_t* task;
+    int index;                      // indice do objeto em ppos_wait_any
+    int* fired;                     // indice do objeto que acordou a tarefa
+} semwatch_t;
+
+// acorda as tarefas em ppos_wait_any neste semáforo, no maximo uma por
+// unidade disponivel, ou todas se units < 0 (deve ser chamada com preempcao
+// desabilitada)
+static void sem_notify(semaphore_t* s, int units) {
+    for (semwatch_t* w = s->watchers; w != NULL && units != 0; w = w->next) {
+        if (*(w->fired) < 0) {
+            *(w->fired) = w->index;
+            task_resume(w->task);
+            units--;
+        }
+    }
+}
+
+// acorda as tarefas em ppos_wait_any no semaforo destruido e desliga os
+// registros delas, que ppos_wait_any nao deve mais tocar (deve ser chamada
+// com preempcao desabilitada)
+static void sem_detach(semaphore_t* s) {
+    semwatch_t* w;
+    sem_notify(s, -1);
+    while ((w = s->watchers) != NULL) {
+        s->watchers = w->next;
+        w->sem = NULL;
+        w->prev = NULL;
+        w->next = NULL;
+    }
+}
+
 // cria um semáforo
 int sem_create(semaphore_t* s, int counter) {
     if (s == NULL) {
@@ -154,11 +368,55 @@ int sem_create(semaphore_t* s, int counter) {
     PPOS_PREEMPT_DISABLE; //disable preemtion to allow atomicity
     s->queue = NULL;
     s->counter = counter;
+    s->order = PPOS_WAIT_FIFO;
+    s->index = NULL;
+    s->watchers = NULL;
     s->active = 1;
     PPOS_PREEMPT_ENABLE; //enables again
     return 0;
 }
 
+// define a ordem de atendimento das tarefas em espera
+int sem_setorder(semaphore_t* s, int order) {
+    if (s == NULL || !(s->active) || (order != PPOS_WAIT_FIFO && order != PPOS_WAIT_PRIO)) {
+        return -1;
+    }
+    PPOS_PREEMPT_DISABLE;
+    if (s->queue != NULL) {
+        PPOS_PREEMPT_ENABLE;
+        return -1;
+    }
+    if (order == PPOS_WAIT_PRIO && s->index == NULL) {
+        s->index = (waitindex_t*) malloc(sizeof(waitindex_t));
+        if (s->index == NULL) {
+            PPOS_PREEMPT_ENABLE;
+            return -1;
+        }
+        s->index->levels = 0;
+    }
+    s->order = order;
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
+// coloca a tarefa corrente na fila de espera do semáforo, conforme a ordem
+// definida (deve ser chamada com preempcao desabilitada)
+static void sem_suspend(semaphore_t* s) {
+    task_suspend(taskExec, &(s->queue));
+    if (s->order == PPOS_WAIT_PRIO) {
+        wait_index_insert(&(s->queue), s->index, taskExec);
+    }
+}
+
+// acorda a primeira tarefa da fila de espera do semáforo
+// (deve ser chamada com preempcao desabilitada)
+static void sem_wakeup(semaphore_t* s) {
+    if (s->order == PPOS_WAIT_PRIO) {
+        wait_index_remove(s->queue, s->index, s->queue);
+    }
+    task_resume(s->queue);
+}
+
 int before_sem_create (semaphore_t *s, int value) {
     // put your customization here
 #ifdef DEBUG_SEM
@@ -175,24 +433,39 @@ int after_sem_create (semaphore_t *s, int value) {
     return 0;
 }
 
-// requisita o semáforo
-int sem_down(semaphore_t* s) {
-    if (s == NULL || !(s->active)) {
+// bloqueia a tarefa corrente no semáforo com o registro de espera wait
+// (chamada com preempcao desabilitada; retorna com ela habilitada)
+static int sem_block(semaphore_t* s, semwait_t* wait) {
+    task_set_wait_data(taskExec, wait);
+    sem_suspend(s);
+    PPOS_PREEMPT_ENABLE;
+    task_yield();
+    if (!(s->active)) {
+        return -1;
+    }
+    return 0;
+}
+
+// requisita k unidades do semáforo; a tarefa so e liberada quando todas
+// as k unidades lhe forem entregues de uma vez por sem_up_n
+int sem_down_n(semaphore_t* s, int k) {
+    if (s == NULL || !(s->active) || k <= 0) {
         return -1;
     }
     PPOS_PREEMPT_DISABLE;
-    s->counter--;
-    if (s->counter < 0) {
-        task_suspend(taskExec, &(s->queue));
+    // havendo tarefas em espera, a nova requisicao aguarda a sua vez
+    if (s->queue == NULL && s->counter >= k) {
+        s->counter -= k;
         PPOS_PREEMPT_ENABLE;
-        task_yield();
-        if (!(s->active)) {
-            return -1;
-        }
         return 0;
     }
-    PPOS_PREEMPT_ENABLE;
-    return 0;
+    semwait_t wait = { k, NULL, 0 };
+    return sem_block(s, &wait);
+}
+
+// requisita o semáforo
+int sem_down(semaphore_t* s) {
+    return sem_down_n(s, 1);
 }
 
 int before_sem_down (semaphore_t *s) {
@@ -211,20 +484,34 @@ int after_sem_down (semaphore_t *s) {
     return 0;
 }
 
-// libera o semáforo
-int sem_up(semaphore_t* s) {
-    PPOS_PREEMPT_DISABLE;
-    if (s == NULL || !(s->active)) {
+// libera k unidades do semáforo e, em uma unica passada pela fila,
+// entrega unidades as tarefas em espera enquanto a primeira puder ser atendida
+int sem_up_n(semaphore_t* s, int k) {
+    if (s == NULL || !(s->active) || k <= 0) {
         return -1;
     }
-    s->counter++;
-    if (s->counter <= 0) {
-        task_resume(s->queue);
+    PPOS_PREEMPT_DISABLE;
+    s->counter += k;
+    while (s->queue != NULL) {
+        int units = ((semwait_t*) task_get_wait_data(s->queue))->units;
+        if (units > s->counter) {
+            break;
+        }
+        s->counter -= units;
+        sem_wakeup(s);
+    }
+    if (s->queue == NULL && s->counter > 0 && s->watchers != NULL) {
+        sem_notify(s, s->counter);
     }
     PPOS_PREEMPT_ENABLE;
     return 0;
 }
 
+// libera o semáforo
+int sem_up(semaphore_t* s) {
+    return sem_up_n(s, 1);
+}
+
 int before_sem_up (semaphore_t *s) {
     // put your customization here
 #ifdef DEBUG_SEM
@@ -249,8 +536,11 @@ int sem_destroy(semaphore_t* s) {
     PPOS_PREEMPT_DISABLE;
     s->active = 0;
     while (s->queue != NULL) {
-        task_resume(s->queue);
+        sem_wakeup(s);
     }
+    sem_detach(s);
+    free(s->index);
+    s->index = NULL;
     PPOS_PREEMPT_ENABLE;
 
     return 0;
@@ -272,6 +562,92 @@ int after_sem_destroy (semaphore_t *s) {
     return 0;
 }
 
+// transfere todas as tarefas da fila src para o final da fila dst com um
+// unico queue_splice (sem queue_remove/queue_append por elemento), ajustando
+// a fila e o estado de cada tarefa transferida
+static void task_queue_splice(task_t** dst, task_t** src, unsigned char state) {
+    task_t *first = *src, *task;
+    if (first == NULL) {
+        return;
+    }
+    task = first;
+    do {
+        task->queue = (task_t*) dst;
+        task->state = state;
+        task = task->next;
+    } while (task != first);
+    queue_splice((queue_t**) dst, (queue_t**) src);
+}
+
+// cria um mutex (sempre inicialmente livre)
+int mutex_create(mutex_t* m) {
+    if (m == NULL) {
+        return -1;
+    }
+    PPOS_PREEMPT_DISABLE;
+    m->queue = NULL;
+    m->value = 1;
+    m->active = 1;
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
+// libera o mutex; havendo tarefas na fila, a posse passa diretamente para
+// a primeira delas (deve ser chamada com preempcao desabilitada)
+static void mutex_release(mutex_t* m) {
+    if (m->queue != NULL) {
+        task_resume(m->queue);
+    } else {
+        m->value = 1;
+    }
+}
+
+// solicita o mutex
+int mutex_lock(mutex_t* m) {
+    if (m == NULL || !(m->active)) {
+        return -1;
+    }
+    PPOS_PREEMPT_DISABLE;
+    if (m->value) {
+        m->value = 0;
+        PPOS_PREEMPT_ENABLE;
+        return 0;
+    }
+    task_suspend(taskExec, &(m->queue));
+    PPOS_PREEMPT_ENABLE;
+    task_yield();
+    // ao ser acordada, a tarefa ja recebeu a posse do mutex
+    if (!(m->active)) {
+        return -1;
+    }
+    return 0;
+}
+
+// libera o mutex
+int mutex_unlock(mutex_t* m) {
+    if (m == NULL || !(m->active)) {
+        return -1;
+    }
+    PPOS_PREEMPT_DISABLE;
+    mutex_release(m);
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
+// destroi o mutex
+int mutex_destroy(mutex_t* m) {
+    if (m == NULL || !(m->active)) {
+        return -1;
+    }
+    PPOS_PREEMPT_DISABLE;
+    m->active = 0;
+    while (m->queue != NULL) {
+        task_resume(m->queue);
+    }
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
 int before_mutex_create (mutex_t *m) {
     // put your customization here
 #ifdef DEBUG
@@ -336,6 +712,203 @@ int after_mutex_destroy (mutex_t *m) {
     return 0;
 }
 
+// cria uma variavel de condicao
+int cond_create(cond_t* c) {
+    if (c == NULL) {
+        return -1;
+    }
+    PPOS_PREEMPT_DISABLE;
+    c->queue = NULL;
+    c->mutex = NULL;
+    c->active = 1;
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
+// libera o mutex e aguarda a condicao; a tarefa so volta a executar
+// quando receber novamente a posse do mutex, mesmo que a condicao tenha
+// sido destruida (retorna -1 sem o mutex apenas se ele foi destruido)
+int cond_wait(cond_t* c, mutex_t* m) {
+    if (c == NULL || !(c->active) || m == NULL || !(m->active)) {
+        return -1;
+    }
+    PPOS_PREEMPT_DISABLE;
+    if (c->queue != NULL && c->mutex != m) {
+        // todas as tarefas em espera devem usar o mesmo mutex
+        PPOS_PREEMPT_ENABLE;
+        return -1;
+    }
+    c->mutex = m;
+    mutex_release(m);
+    task_suspend(taskExec, &(c->queue));
+    PPOS_PREEMPT_ENABLE;
+    task_yield();
+    if (!(m->active)) {
+        return -1;
+    }
+    return 0;
+}
+
+// transfere a primeira tarefa em espera para o mutex: se ele estiver livre,
+// a tarefa recebe a posse e volta a fila de prontas; caso contrario, passa
+// a aguardar na fila do mutex (deve ser chamada com preempcao desabilitada)
+static void cond_requeue_one(cond_t* c) {
+    mutex_t *m = c->mutex;
+    if (m->value) {
+        m->value = 0;
+        task_resume(c->queue);
+    } else {
+        task_suspend(c->queue, &(m->queue));
+    }
+}
+
+// sinaliza a condicao, liberando uma tarefa
+int cond_signal(cond_t* c) {
+    if (c == NULL || !(c->active)) {
+        return -1;
+    }
+    PPOS_PREEMPT_DISABLE;
+    if (c->queue != NULL) {
+        cond_requeue_one(c);
+    }
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
+// transfere todas as tarefas em espera: em vez de acorda-las todas (que
+// voltariam a disputar o mutex), move a fila inteira para a fila do mutex
+// (deve ser chamada com preempcao desabilitada)
+static void cond_requeue_all(cond_t* c) {
+    if (c->queue != NULL) {
+        cond_requeue_one(c);
+        task_queue_splice(&(c->mutex->queue), &(c->queue), CORE_TASK_STATE_SUSPENDED);
+    }
+}
+
+// sinaliza a condicao para todas as tarefas
+int cond_broadcast(cond_t* c) {
+    if (c == NULL || !(c->active)) {
+        return -1;
+    }
+    PPOS_PREEMPT_DISABLE;
+    cond_requeue_all(c);
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
+// destroi a variavel de condicao; as tarefas em espera sao liberadas como
+// em um broadcast e retornam 0 do cond_wait com o mutex, cabendo a elas
+// verificar o estado protegido
+int cond_destroy(cond_t* c) {
+    if (c == NULL || !(c->active)) {
+        return -1;
+    }
+    PPOS_PREEMPT_DISABLE;
+    c->active = 0;
+    cond_requeue_all(c);
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
+// cria uma barreira para N tarefas
+int barrier_create(barrier_t* b, int N) {
+    if (b == NULL || N <= 0) {
+        return -1;
+    }
+    PPOS_PREEMPT_DISABLE;
+    before_barrier_create(b, N);
+    b->queue = NULL;
+    b->maxTasks = N;
+    b->countTasks = N;
+    b->sense = 0;
+    b->active = 1;
+    b->phases = 0;
+    b->phaseStart = 0;
+    for (int i = 0; i < BARRIER_HIST_BUCKETS; i++) {
+        b->waitHist[i] = 0;
+    }
+    after_barrier_create(b, N);
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
+// registra no histograma a espera da fase que acaba de terminar
+static void barrier_record_phase(barrier_t* b) {
+    unsigned int wait = systime() - b->phaseStart;
+    int bucket = 0;
+    while (wait > 0 && bucket < BARRIER_HIST_BUCKETS - 1) {
+        wait >>= 1;
+        bucket++;
+    }
+    b->waitHist[bucket]++;
+    b->phases++;
+}
+
+// chega a barreira; a ultima tarefa a chegar inverte o sentido da fase,
+// rearma o contador e devolve todas as tarefas em espera a fila de prontas
+// de uma so vez
+int barrier_join(barrier_t* b) {
+    if (b == NULL || !(b->active)) {
+        return -1;
+    }
+    PPOS_PREEMPT_DISABLE;
+    before_barrier_join(b);
+    unsigned char localSense = !(b->sense);
+    if (b->countTasks == b->maxTasks) {
+        b->phaseStart = systime();
+    }
+    b->countTasks--;
+    if (b->countTasks == 0) {
+        barrier_record_phase(b);
+        b->countTasks = b->maxTasks;
+        b->sense = localSense;
+        task_queue_splice(&readyQueue, &(b->queue), CORE_TASK_STATE_READY);
+        after_barrier_join(b);
+        PPOS_PREEMPT_ENABLE;
+        return 0;
+    }
+    while (b->sense != localSense && b->active) {
+        task_suspend(taskExec, &(b->queue));
+        PPOS_PREEMPT_ENABLE;
+        task_yield();
+        PPOS_PREEMPT_DISABLE;
+    }
+    after_barrier_join(b);
+    PPOS_PREEMPT_ENABLE;
+    if (!(b->active)) {
+        return -1;
+    }
+    return 0;
+}
+
+// destroi a barreira, liberando as tarefas em espera
+int barrier_destroy(barrier_t* b) {
+    if (b == NULL || !(b->active)) {
+        return -1;
+    }
+    PPOS_PREEMPT_DISABLE;
+    before_barrier_destroy(b);
+    b->active = 0;
+    task_queue_splice(&readyQueue, &(b->queue), CORE_TASK_STATE_READY);
+    after_barrier_destroy(b);
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
+// copia o histograma de espera por fase da barreira
+int barrier_histogram(barrier_t* b, unsigned int* hist, int n) {
+    if (b == NULL || hist == NULL || n < 0) {
+        return -1;
+    }
+    if (n > BARRIER_HIST_BUCKETS) {
+        n = BARRIER_HIST_BUCKETS;
+    }
+    for (int i = 0; i < n; i++) {
+        hist[i] = b->waitHist[i];
+    }
+    return b->phases;
+}
+
 int before_barrier_create (barrier_t *b, int N) {
     // put your customization here
 #ifdef DEBUG
@@ -384,6 +957,978 @@ int after_barrier_destroy (barrier_t *b) {
     return 0;
 }
 
+// fila que usa o buffer circular de posicoes de tamanho fixo (nem de tamanho
+// variavel nem com prioridades)
+#define MQUEUE_IS_PLAIN(queue) (!(queue)->varlen && (queue)->prio == NULL)
+
+// cria uma fila para ate max mensagens de size bytes cada
+int mqueue_create(mqueue_t* queue, int max, int size) {
+    if (queue == NULL || max <= 0 || size <= 0) {
+        return -1;
+    }
+    PPOS_PREEMPT_DISABLE;
+    before_mqueue_create(queue, max, size);
+    queue->content = malloc(max * size);
+    queue->slotOwner = (task_t**) calloc(max, sizeof(task_t*));
+    if (queue->content == NULL || queue->slotOwner == NULL) {
+        free(queue->content);
+        free(queue->slotOwner);
+        PPOS_PREEMPT_ENABLE;
+        return -1;
+    }
+    queue->messageSize = size;
+    queue->maxMessages = max;
+    queue->countMessages = 0;
+    queue->head = 0;
+    queue->tail = 0;
+    queue->prodPending = 0;
+    queue->consPending = 0;
+    queue->varlen = 0;
+    queue->prio = NULL;
+    sem_create(&(queue->sItem), 0);
+    sem_create(&(queue->sVaga), max);
+    queue->active = 1;
+    after_mqueue_create(queue, max, size);
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
+// toma a posicao *next do buffer circular para a tarefa corrente
+// (deve ser chamada com preempcao desabilitada)
+static void* mqueue_slot_take(mqueue_t* queue, int* next, int* pending) {
+    int slot = *next;
+    queue->slotOwner[slot] = taskExec;
+    if (++(*next) == queue->maxMessages) {
+        *next = 0;
+    }
+    (*pending)++;
+    return (char*) queue->content + slot * queue->messageSize;
+}
+
+// conclui as count posicoes mais antigas detidas pela tarefa corrente dentre
+// as *pending posicoes anteriores a next; como as posicoes podem ser
+// concluidas fora de ordem, retorna quantas posicoes consecutivas, a partir
+// da mais antiga, ficaram concluidas (deve ser chamada com preempcao desabilitada)
+static int mqueue_slot_done(mqueue_t* queue, int next, int* pending, int count) {
+    int max = queue->maxMessages;
+    int first = (next - *pending + max) % max;
+    int i, found = 0, done = 0;
+
+    for (i = 0; i < *pending && found < count; i++) {
+        int slot = (first + i) % max;
+        if (queue->slotOwner[slot] == taskExec) {
+            queue->slotOwner[slot] = NULL;
+            found++;
+        }
+    }
+    if (found == 0) {
+        return -1;  // a tarefa corrente nao detem nenhuma posicao
+    }
+    while (*pending > 0 && queue->slotOwner[(first + done) % max] == NULL) {
+        done++;
+        (*pending)--;
+    }
+    return done;
+}
+
+// reserva uma posicao livre, onde o produtor escreve a mensagem diretamente
+void* mqueue_reserve(mqueue_t* queue) {
+    void* slot;
+    if (queue == NULL || !(queue->active) || !MQUEUE_IS_PLAIN(queue)) {
+        return NULL;
+    }
+    if (sem_down(&(queue->sVaga)) == -1) {
+        return NULL;
+    }
+    PPOS_PREEMPT_DISABLE;
+    if (!(queue->active)) {
+        PPOS_PREEMPT_ENABLE;
+        return NULL;
+    }
+    slot = mqueue_slot_take(queue, &(queue->tail), &(queue->prodPending));
+    PPOS_PREEMPT_ENABLE;
+    return slot;
+}
+
+// torna visiveis count mensagens ja escritas no buffer, entregando-as aos
+// receptores em espera sem preempcao desde a contagem: do contrario, um
+// emissor em mqueue_deliver poderia ver o receptor ainda em espera e
+// entregar-lhe uma mensagem posterior a estas (chamada com preempcao
+// desabilitada; retorna com ela habilitada)
+static void mqueue_publish(mqueue_t* queue, int count) {
+    if (count > 0) {
+        queue->countMessages += count;
+        sem_up_n(&(queue->sItem), count);
+    }
+    PPOS_PREEMPT_ENABLE;
+}
+
+// publica a posicao reservada pela tarefa corrente; as mensagens so ficam
+// visiveis aos receptores na ordem em que as posicoes foram reservadas
+int mqueue_commit(mqueue_t* queue) {
+    int published;
+    if (queue == NULL || !(queue->active)) {
+        return -1;
+    }
+    PPOS_PREEMPT_DISABLE;
+    published = mqueue_slot_done(queue, queue->tail, &(queue->prodPending), 1);
+    if (published < 0) {
+        PPOS_PREEMPT_ENABLE;
+        return -1;
+    }
+    mqueue_publish(queue, published);
+    return 0;
+}
+
+// toma a mensagem mais antiga da fila para a tarefa corrente, que ja obteve
+// uma unidade de sItem (chamada com preempcao desabilitada; retorna com ela
+// habilitada)
+static const void* mqueue_borrow(mqueue_t* queue) {
+    const void* slot;
+    if (!(queue->active)) {
+        PPOS_PREEMPT_ENABLE;
+        return NULL;
+    }
+    slot = mqueue_slot_take(queue, &(queue->head), &(queue->consPending));
+    queue->countMessages--;
+    PPOS_PREEMPT_ENABLE;
+    return slot;
+}
+
+// empresta a mensagem mais antiga da fila, que o receptor le no proprio buffer
+const void* mqueue_peek(mqueue_t* queue) {
+    if (queue == NULL || !(queue->active) || !MQUEUE_IS_PLAIN(queue)) {
+        return NULL;
+    }
+    if (sem_down(&(queue->sItem)) == -1) {
+        return NULL;
+    }
+    PPOS_PREEMPT_DISABLE;
+    return mqueue_borrow(queue);
+}
+
+// devolve a posicao emprestada pela tarefa corrente; as posicoes so voltam
+// a ficar livres na ordem em que foram emprestadas
+int mqueue_release(mqueue_t* queue) {
+    int freed;
+    if (queue == NULL || !(queue->active)) {
+        return -1;
+    }
+    PPOS_PREEMPT_DISABLE;
+    freed = mqueue_slot_done(queue, queue->head, &(queue->consPending), 1);
+    PPOS_PREEMPT_ENABLE;
+    if (freed < 0) {
+        return -1;
+    }
+    if (freed > 0) {
+        sem_up_n(&(queue->sVaga), freed);
+    }
+    return 0;
+}
+
+// entrega a mensagem diretamente a um receptor bloqueado em mqueue_recv,
+// sem passar pelo buffer da fila; so e possivel se nao houver publicacoes
+// pendentes que devam chegar antes (chamada com preempcao desabilitada)
+static int mqueue_deliver(mqueue_t* queue, void* msg) {
+    semwait_t* wait;
+    if (queue->sItem.queue == NULL || queue->prodPending > 0) {
+        return 0;
+    }
+    wait = (semwait_t*) task_get_wait_data(queue->sItem.queue);
+    if (wait->msg == NULL) {
+        return 0;  // receptor e um mqueue_peek, que precisa de uma posicao
+    }
+    memcpy(wait->msg, msg, queue->messageSize);
+    wait->delivered = 1;
+    sem_wakeup(&(queue->sItem));
+    return 1;
+}
+
+// filas por nivel de uma fila com prioridades: as mensagens ficam nas
+// posicoes de content e cada nivel guarda, em seu proprio anel, os indices
+// das posicoes em ordem de chegada
+typedef struct mqprio_t {
+    int* ring[MQUEUE_PRIO_LEVELS];  // anel de indices de posicoes de cada nivel
+    int head[MQUEUE_PRIO_LEVELS];
+    int count[MQUEUE_PRIO_LEVELS];
+    unsigned int levels;            // bit i ligado: nivel i nao vazio
+    int nfree;
+    int* freeSlot;                  // pilha de posicoes livres de content
+    int slots[];                    // armazenamento dos aneis e da pilha
+} mqprio_t;
+
+// cria uma fila com prioridades; a capacidade (sVaga) e compartilhada entre
+// os niveis, e cada anel comporta a fila inteira
+int mqueue_create_prio(mqueue_t* queue, int max, int size) {
+    mqprio_t* prio;
+    int i;
+    if (mqueue_create(queue, max, size) < 0) {
+        return -1;
+    }
+    prio = malloc(sizeof(mqprio_t) + (MQUEUE_PRIO_LEVELS + 1) * max * sizeof(int));
+    if (prio == NULL) {
+        mqueue_destroy(queue);
+        return -1;
+    }
+    for (i = 0; i < MQUEUE_PRIO_LEVELS; i++) {
+        prio->ring[i] = prio->slots + i * max;
+        prio->head[i] = 0;
+        prio->count[i] = 0;
+    }
+    prio->levels = 0;
+    prio->freeSlot = prio->slots + MQUEUE_PRIO_LEVELS * max;
+    for (i = 0; i < max; i++) {
+        prio->freeSlot[i] = max - 1 - i;
+    }
+    prio->nfree = max;
+    queue->prio = prio;
+    return 0;
+}
+
+// envia uma mensagem no nivel prio; se houver receptor aguardando, a fila
+// esta vazia e a mensagem e entregue diretamente a ele
+int mqueue_send_prio(mqueue_t* queue, void* msg, int prio) {
+    mqprio_t* p;
+    int slot;
+    if (queue == NULL || !(queue->active) || queue->prio == NULL ||
+        prio < 0 || prio >= MQUEUE_PRIO_LEVELS) {
+        return -1;
+    }
+    before_mqueue_send(queue, msg);
+    PPOS_PREEMPT_DISABLE;
+    if (mqueue_deliver(queue, msg)) {
+        PPOS_PREEMPT_ENABLE;
+        after_mqueue_send(queue, msg);
+        return 0;
+    }
+    PPOS_PREEMPT_ENABLE;
+    if (sem_down(&(queue->sVaga)) == -1) {
+        return -1;
+    }
+    PPOS_PREEMPT_DISABLE;
+    if (!(queue->active)) {
+        PPOS_PREEMPT_ENABLE;
+        return -1;
+    }
+    p = queue->prio;
+    slot = p->freeSlot[--(p->nfree)];
+    memcpy((char*) queue->content + slot * queue->messageSize, msg, queue->messageSize);
+    p->ring[prio][(p->head[prio] + p->count[prio]) % queue->maxMessages] = slot;
+    p->count[prio]++;
+    p->levels |= 1u << prio;
+    mqueue_publish(queue, 1);
+    after_mqueue_send(queue, msg);
+    return 0;
+}
+
+// recebe a mensagem mais antiga do nivel mais urgente nao vazio
+static int mqueue_recv_prio(mqueue_t* queue, void* msg) {
+    semwait_t wait = { 1, msg, 0 };
+    mqprio_t* p;
+    int level, slot;
+    if (!(queue->active)) {
+        return -1;
+    }
+    before_mqueue_recv(queue, msg);
+    PPOS_PREEMPT_DISABLE;
+    if (queue->sItem.queue == NULL && queue->sItem.counter > 0) {
+        queue->sItem.counter--;
+    } else {
+        if (sem_block(&(queue->sItem), &wait) < 0) {
+            return -1;
+        }
+        if (wait.delivered) {
+            after_mqueue_recv(queue, msg);
+            return 0;
+        }
+        PPOS_PREEMPT_DISABLE;
+    }
+    if (!(queue->active)) {
+        PPOS_PREEMPT_ENABLE;
+        return -1;
+    }
+    p = queue->prio;
+    level = 31 - __builtin_clz(p->levels);
+    slot = p->ring[level][p->head[level]];
+    if (++(p->head[level]) == queue->maxMessages) {
+        p->head[level] = 0;
+    }
+    if (--(p->count[level]) == 0) {
+        p->levels &= ~(1u << level);
+    }
+    memcpy(msg, (char*) queue->content + slot * queue->messageSize, queue->messageSize);
+    p->freeSlot[(p->nfree)++] = slot;
+    queue->countMessages--;
+    PPOS_PREEMPT_ENABLE;
+    sem_up(&(queue->sVaga));
+    after_mqueue_recv(queue, msg);
+    return 0;
+}
+
+// envia uma mensagem para a fila (copia sobre mqueue_reserve/mqueue_commit,
+// ou diretamente para o receptor, se houver um aguardando)
+int mqueue_send(mqueue_t* queue, void* msg) {
+    void* slot;
+    if (queue != NULL && queue->prio != NULL) {
+        return mqueue_send_prio(queue, msg, 0);
+    }
+    if (queue == NULL || !(queue->active) || !MQUEUE_IS_PLAIN(queue)) {
+        return -1;
+    }
+    before_mqueue_send(queue, msg);
+    PPOS_PREEMPT_DISABLE;
+    if (mqueue_deliver(queue, msg)) {
+        PPOS_PREEMPT_ENABLE;
+        after_mqueue_send(queue, msg);
+        return 0;
+    }
+    PPOS_PREEMPT_ENABLE;
+    if ((slot = mqueue_reserve(queue)) == NULL) {
+        return -1;
+    }
+    memcpy(slot, msg, queue->messageSize);
+    if (mqueue_commit(queue) < 0) {
+        return -1;
+    }
+    after_mqueue_send(queue, msg);
+    return 0;
+}
+
+// recebe a mensagem mais antiga da fila (copia sobre mqueue_peek/mqueue_release);
+// se a fila estiver vazia, aguarda oferecendo msg para entrega direta pelo emissor
+int mqueue_recv(mqueue_t* queue, void* msg) {
+    const void* slot;
+    semwait_t wait = { 1, msg, 0 };
+    if (queue != NULL && queue->prio != NULL) {
+        return mqueue_recv_prio(queue, msg);
+    }
+    if (queue == NULL || !(queue->active) || !MQUEUE_IS_PLAIN(queue)) {
+        return -1;
+    }
+    before_mqueue_recv(queue, msg);
+    PPOS_PREEMPT_DISABLE;
+    if (queue->sItem.queue == NULL && queue->sItem.counter > 0) {
+        queue->sItem.counter--;
+    } else {
+        if (sem_block(&(queue->sItem), &wait) < 0) {
+            return -1;
+        }
+        if (wait.delivered) {
+            after_mqueue_recv(queue, msg);
+            return 0;
+        }
+        PPOS_PREEMPT_DISABLE;
+    }
+    if ((slot = mqueue_borrow(queue)) == NULL) {
+        return -1;
+    }
+    memcpy(msg, slot, queue->messageSize);
+    if (mqueue_release(queue) < 0) {
+        return -1;
+    }
+    after_mqueue_recv(queue, msg);
+    return 0;
+}
+
+// envia n mensagens consecutivas de msgs; a cada passada, ocupa todas as
+// posicoes livres de uma vez e acorda os receptores uma unica vez por lote.
+// Se a fila for destruida no meio, retorna quantas mensagens ja foram
+// enviadas (-1 somente se nenhuma foi). Os ganchos de envio sao chamados
+// uma vez por chamada, com msgs
+int mqueue_send_n(mqueue_t* queue, void* msgs, int n) {
+    char* msg = (char*) msgs;
+    int sent = 0;
+    if (queue == NULL || !(queue->active) || !MQUEUE_IS_PLAIN(queue) || msgs == NULL || n < 0) {
+        return -1;
+    }
+    before_mqueue_send(queue, msgs);
+    while (sent < n) {
+        semwait_t wait = { 1, NULL, 0 };
+        int batch, published, i;
+
+        PPOS_PREEMPT_DISABLE;
+        while (sent < n && mqueue_deliver(queue, msg)) {
+            msg += queue->messageSize;
+            sent++;
+        }
+        if (sent == n) {
+            PPOS_PREEMPT_ENABLE;
+            break;
+        }
+        // aguarda ao menos uma posicao livre, se necessario
+        if (queue->sVaga.queue != NULL || queue->sVaga.counter == 0) {
+            if (sem_block(&(queue->sVaga), &wait) < 0) {
+                break;
+            }
+            PPOS_PREEMPT_DISABLE;
+            batch = 1;
+        } else {
+            batch = 0;
+        }
+        if (!(queue->active)) {
+            PPOS_PREEMPT_ENABLE;
+            break;
+        }
+        // soma as demais posicoes livres, se ninguem mais estiver esperando
+        if (queue->sVaga.queue == NULL) {
+            int extra = n - sent - batch;
+            if (extra > queue->sVaga.counter) {
+                extra = queue->sVaga.counter;
+            }
+            queue->sVaga.counter -= extra;
+            batch += extra;
+        }
+        // copia o lote sem preempcao desde a verificacao de active acima:
+        // mqueue_destroy nao pode liberar o buffer no meio da copia
+        for (i = 0; i < batch; i++) {
+            memcpy(mqueue_slot_take(queue, &(queue->tail), &(queue->prodPending)),
+                   msg, queue->messageSize);
+            msg += queue->messageSize;
+        }
+        published = mqueue_slot_done(queue, queue->tail, &(queue->prodPending), batch);
+        mqueue_publish(queue, published);
+        sent += batch;
+    }
+    if (sent == 0 && n > 0) {
+        return -1;
+    }
+    after_mqueue_send(queue, msgs);
+    return sent;
+}
+
+// recebe de uma vez todas as mensagens disponiveis, ate max, em out;
+// bloqueia somente ate haver min mensagens na fila. Retorna o numero de
+// mensagens recebidas ou -1 em erro; como o lote e tomado de uma so vez,
+// um erro ocorre sempre antes de alguma mensagem ser retirada da fila.
+// Os ganchos de recepcao sao chamados uma vez por chamada, com out
+int mqueue_recv_n(mqueue_t* queue, void* out, int max, int min) {
+    semwait_t wait = { min, NULL, 0 };
+    char* msg = (char*) out;
+    int batch = 0, freed, i;
+
+    if (queue == NULL || !(queue->active) || !MQUEUE_IS_PLAIN(queue) || out == NULL ||
+        max <= 0 || min < 0 || min > max) {
+        return -1;
+    }
+    before_mqueue_recv(queue, out);
+    PPOS_PREEMPT_DISABLE;
+    if (min > 0 && (queue->sItem.queue != NULL || queue->sItem.counter < min)) {
+        if (sem_block(&(queue->sItem), &wait) < 0) {
+            return -1;
+        }
+        PPOS_PREEMPT_DISABLE;
+        batch = min;
+    }
+    if (!(queue->active)) {
+        PPOS_PREEMPT_ENABLE;
+        return -1;
+    }
+    // soma as demais mensagens disponiveis, se ninguem mais estiver esperando
+    if (queue->sItem.queue == NULL) {
+        int extra = max - batch;
+        if (extra > queue->sItem.counter) {
+            extra = queue->sItem.counter;
+        }
+        queue->sItem.counter -= extra;
+        batch += extra;
+    }
+    // copia o lote sem preempcao desde a verificacao de active acima:
+    // mqueue_destroy nao pode liberar o buffer no meio da copia
+    for (i = 0; i < batch; i++) {
+        memcpy(msg, mqueue_slot_take(queue, &(queue->head), &(queue->consPending)),
+               queue->messageSize);
+        msg += queue->messageSize;
+    }
+    queue->countMessages -= batch;
+    freed = batch > 0 ? mqueue_slot_done(queue, queue->head, &(queue->consPending), batch) : 0;
+    PPOS_PREEMPT_ENABLE;
+    if (freed > 0) {
+        sem_up_n(&(queue->sVaga), freed);
+    }
+    after_mqueue_recv(queue, out);
+    return batch;
+}
+
+// cabecalho de cada mensagem no anel de bytes de uma fila de tamanho variavel
+typedef unsigned int mqueue_varhdr_t;
+
+// cria uma fila de mensagens de tamanho variavel com capacity bytes; a
+// capacidade livre e controlada por sVaga, em bytes, e sItem conta mensagens
+int mqueue_create_var(mqueue_t* queue, int capacity) {
+    if (queue == NULL || capacity <= (int) sizeof(mqueue_varhdr_t)) {
+        return -1;
+    }
+    PPOS_PREEMPT_DISABLE;
+    before_mqueue_create(queue, capacity, 0);
+    if ((queue->content = malloc(capacity)) == NULL) {
+        PPOS_PREEMPT_ENABLE;
+        return -1;
+    }
+    queue->slotOwner = NULL;
+    queue->messageSize = 0;
+    queue->maxMessages = capacity;
+    queue->countMessages = 0;
+    queue->head = 0;
+    queue->tail = 0;
+    queue->prodPending = 0;
+    queue->consPending = 0;
+    queue->varlen = 1;
+    queue->prio = NULL;
+    sem_create(&(queue->sItem), 0);
+    sem_create(&(queue->sVaga), capacity);
+    queue->active = 1;
+    after_mqueue_create(queue, capacity, 0);
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
+// copia n bytes de src para o anel a partir de pos, dando a volta no fim;
+// retorna a posicao seguinte
+static int mqueue_ring_write(mqueue_t* queue, int pos, const void* src, int n) {
+    int first = queue->maxMessages - pos;
+    if (first > n) {
+        first = n;
+    }
+    memcpy((char*) queue->content + pos, src, first);
+    memcpy(queue->content, (const char*) src + first, n - first);
+    return (pos + n) % queue->maxMessages;
+}
+
+// copia n bytes do anel, a partir de pos, para dst; retorna a posicao seguinte
+static int mqueue_ring_read(mqueue_t* queue, int pos, void* dst, int n) {
+    int first = queue->maxMessages - pos;
+    if (first > n) {
+        first = n;
+    }
+    memcpy(dst, (char*) queue->content + pos, first);
+    memcpy((char*) dst + first, queue->content, n - first);
+    return (pos + n) % queue->maxMessages;
+}
+
+// envia uma mensagem de len bytes; o emissor aguarda ate haver espaco para
+// o cabecalho e a mensagem inteira, na ordem de chegada
+int mqueue_send_var(mqueue_t* queue, const void* msg, int len) {
+    mqueue_varhdr_t hdr = len;
+    int frame = sizeof(hdr) + len;
+    if (queue == NULL || !(queue->active) || !(queue->varlen) ||
+        (msg == NULL && len > 0) || len < 0 || frame > queue->maxMessages) {
+        return -1;
+    }
+    before_mqueue_send(queue, (void*) msg);
+    if (sem_down_n(&(queue->sVaga), frame) == -1) {
+        return -1;
+    }
+    PPOS_PREEMPT_DISABLE;
+    if (!(queue->active)) {
+        PPOS_PREEMPT_ENABLE;
+        return -1;
+    }
+    queue->tail = mqueue_ring_write(queue, queue->tail, &hdr, sizeof(hdr));
+    queue->tail = mqueue_ring_write(queue, queue->tail, msg, len);
+    mqueue_publish(queue, 1);
+    after_mqueue_send(queue, (void*) msg);
+    return 0;
+}
+
+// recebe a mensagem mais antiga da fila em msg, retornando seu tamanho
+int mqueue_recv_var(mqueue_t* queue, void* msg, int maxlen) {
+    mqueue_varhdr_t hdr;
+    int pos;
+    if (queue == NULL || !(queue->active) || !(queue->varlen) ||
+        (msg == NULL && maxlen > 0) || maxlen < 0) {
+        return -1;
+    }
+    before_mqueue_recv(queue, msg);
+    if (sem_down(&(queue->sItem)) == -1) {
+        return -1;
+    }
+    PPOS_PREEMPT_DISABLE;
+    if (!(queue->active)) {
+        PPOS_PREEMPT_ENABLE;
+        return -1;
+    }
+    pos = mqueue_ring_read(queue, queue->head, &hdr, sizeof(hdr));
+    if ((int) hdr > maxlen) {
+        // a mensagem permanece na fila para um receptor com buffer maior
+        PPOS_PREEMPT_ENABLE;
+        sem_up(&(queue->sItem));
+        return -1;
+    }
+    queue->head = mqueue_ring_read(queue, pos, msg, hdr);
+    queue->countMessages--;
+    PPOS_PREEMPT_ENABLE;
+    sem_up_n(&(queue->sVaga), sizeof(hdr) + hdr);
+    after_mqueue_recv(queue, msg);
+    return hdr;
+}
+
+// destroi a fila, liberando as tarefas bloqueadas
+int mqueue_destroy(mqueue_t* queue) {
+    if (queue == NULL || !(queue->active)) {
+        return -1;
+    }
+    before_mqueue_destroy(queue);
+    queue->active = 0;
+    sem_destroy(&(queue->sItem));
+    sem_destroy(&(queue->sVaga));
+    free(queue->content);
+    free(queue->slotOwner);
+    free(queue->prio);
+    queue->content = NULL;
+    queue->slotOwner = NULL;
+    queue->prio = NULL;
+    after_mqueue_destroy(queue);
+    return 0;
+}
+
+// informa o numero de mensagens atualmente na fila
+int mqueue_msgs(mqueue_t* queue) {
+    if (queue == NULL || !(queue->active)) {
+        return -1;
+    }
+    return queue->countMessages;
+}
+
+// define a ordem de atendimento das tarefas bloqueadas na fila
+int mqueue_setorder(mqueue_t* queue, int order) {
+    if (queue == NULL || !(queue->active)) {
+        return -1;
+    }
+    if (sem_setorder(&(queue->sItem), order) < 0 ||
+        sem_setorder(&(queue->sVaga), order) < 0) {
+        return -1;
+    }
+    return 0;
+}
+
+// cria um topico com anel de max mensagens de size bytes
+int topic_create(topic_t* topic, int max, int size, int policy) {
+    if (topic == NULL || max <= 0 || size <= 0 ||
+        (policy != TOPIC_BLOCK && policy != TOPIC_DROP_OLDEST)) {
+        return -1;
+    }
+    topic->content = malloc(max * size);
+    topic->refs = (int*) calloc(max, sizeof(int));
+    if (topic->content == NULL || topic->refs == NULL) {
+        free(topic->content);
+        free(topic->refs);
+        return -1;
+    }
+    PPOS_PREEMPT_DISABLE;
+    topic->messageSize = size;
+    topic->maxMessages = max;
+    topic->head = 0;
+    topic->tail = 0;
+    topic->policy = policy;
+    topic->countSubs = 0;
+    topic->subs = NULL;
+    topic->pubQueue = NULL;
+    topic->subQueue = NULL;
+    topic->active = 1;
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
+// recupera as posicoes mais antigas que todos os assinantes ja passaram e
+// acorda os publicadores se alguma foi recuperada (deve ser chamada com
+// preempcao desabilitada)
+static void topic_reclaim(topic_t* topic) {
+    unsigned long head = topic->head;
+    while (topic->head < topic->tail && topic->refs[topic->head % topic->maxMessages] == 0) {
+        topic->head++;
+    }
+    if (topic->head != head) {
+        task_queue_splice(&readyQueue, &(topic->pubQueue), CORE_TASK_STATE_READY);
+    }
+}
+
+// o assinante passa da posicao seq (chamada com preempcao desabilitada)
+static void topic_pass(topic_t* topic, unsigned long seq) {
+    topic->refs[seq % topic->maxMessages]--;
+    topic_reclaim(topic);
+}
+
+// descarta a mensagem mais antiga para os assinantes que ainda nao a leram;
+// falha se algum deles a tiver emprestado (chamada com preempcao desabilitada).
+// A posicao e fixada antes dos lacos: recuperar o anel a cada assinante
+// avancaria head e descartaria tambem a mensagem seguinte de quem ja leu a
+// mais antiga
+static int topic_drop_oldest(topic_t* topic) {
+    unsigned long oldest = topic->head;
+    topic_sub_t* sub;
+    for (sub = topic->subs; sub != NULL; sub = sub->next) {
+        if (sub->cursor == oldest && sub->borrowed) {
+            return -1;
+        }
+    }
+    for (sub = topic->subs; sub != NULL; sub = sub->next) {
+        if (sub->cursor == oldest) {
+            sub->cursor++;
+            sub->dropped++;
+            topic->refs[oldest % topic->maxMessages]--;
+        }
+    }
+    topic_reclaim(topic);
+    return 0;
+}
+
+// publica uma mensagem; com o anel cheio, aguarda o assinante mais lento
+// (TOPIC_BLOCK) ou descarta para ele a mensagem mais antiga (TOPIC_DROP_OLDEST)
+int topic_publish(topic_t* topic, void* msg) {
+    int slot;
+    if (topic == NULL || !(topic->active) || msg == NULL) {
+        return -1;
+    }
+    PPOS_PREEMPT_DISABLE;
+    while (topic->active && topic->tail - topic->head == (unsigned long) topic->maxMessages) {
+        if (topic->policy == TOPIC_DROP_OLDEST && topic_drop_oldest(topic) == 0) {
+            continue;
+        }
+        task_suspend(taskExec, &(topic->pubQueue));
+        PPOS_PREEMPT_ENABLE;
+        task_yield();
+        PPOS_PREEMPT_DISABLE;
+    }
+    if (!(topic->active)) {
+        PPOS_PREEMPT_ENABLE;
+        return -1;
+    }
+    if (topic->countSubs == 0) {
+        // sem assinantes a mensagem nao tem leitores e nao precisa ser retida
+        PPOS_PREEMPT_ENABLE;
+        return 0;
+    }
+    slot = topic->tail % topic->maxMessages;
+    memcpy((char*) topic->content + slot * topic->messageSize, msg, topic->messageSize);
+    topic->refs[slot] = topic->countSubs;
+    topic->tail++;
+    task_queue_splice(&readyQueue, &(topic->subQueue), CORE_TASK_STATE_READY);
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
+// assina o topico a partir da proxima publicacao
+int topic_subscribe(topic_t* topic, topic_sub_t* sub) {
+    if (topic == NULL || !(topic->active) || sub == NULL) {
+        return -1;
+    }
+    PPOS_PREEMPT_DISABLE;
+    sub->topic = topic;
+    sub->cursor = topic->tail;
+    sub->dropped = 0;
+    sub->borrowed = 0;
+    sub->active = 1;
+    sub->prev = NULL;
+    sub->next = topic->subs;
+    if (topic->subs != NULL) {
+        topic->subs->prev = sub;
+    }
+    topic->subs = sub;
+    topic->countSubs++;
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
+// cancela a assinatura; as mensagens nao lidas deixam de conta-la. Se o
+// assinante estiver aguardando em topic_peek (cancelado por outra tarefa),
+// ele e acordado e recebe NULL
+int topic_unsubscribe(topic_sub_t* sub) {
+    topic_t* topic;
+    if (sub == NULL || !(sub->active)) {
+        return -1;
+    }
+    PPOS_PREEMPT_DISABLE;
+    topic = sub->topic;
+    sub->active = 0;
+    if (topic->active) {
+        if (sub->prev != NULL) {
+            sub->prev->next = sub->next;
+        } else {
+            topic->subs = sub->next;
+        }
+        if (sub->next != NULL) {
+            sub->next->prev = sub->prev;
+        }
+        topic->countSubs--;
+        while (sub->cursor < topic->tail) {
+            topic_pass(topic, sub->cursor++);
+        }
+        // a fila e comum a todos os assinantes: os demais voltam a aguardar
+        task_queue_splice(&readyQueue, &(topic->subQueue), CORE_TASK_STATE_READY);
+    }
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
+// empresta a proxima mensagem do assinante, aguardando uma publicacao se
+// necessario
+const void* topic_peek(topic_sub_t* sub) {
+    topic_t* topic;
+    const void* slot;
+    if (sub == NULL || !(sub->active) || sub->borrowed) {
+        return NULL;
+    }
+    topic = sub->topic;
+    PPOS_PREEMPT_DISABLE;
+    while (topic->active && sub->active && sub->cursor == topic->tail) {
+        task_suspend(taskExec, &(topic->subQueue));
+        PPOS_PREEMPT_ENABLE;
+        task_yield();
+        PPOS_PREEMPT_DISABLE;
+    }
+    if (!(topic->active) || !(sub->active)) {
+        PPOS_PREEMPT_ENABLE;
+        return NULL;
+    }
+    sub->borrowed = 1;
+    slot = (char*) topic->content + (sub->cursor % topic->maxMessages) * topic->messageSize;
+    PPOS_PREEMPT_ENABLE;
+    return slot;
+}
+
+// devolve a mensagem emprestada e avanca o cursor do assinante
+int topic_release(topic_sub_t* sub) {
+    if (sub == NULL || !(sub->active) || !(sub->borrowed)) {
+        return -1;
+    }
+    PPOS_PREEMPT_DISABLE;
+    if (!(sub->topic->active)) {
+        PPOS_PREEMPT_ENABLE;
+        return -1;
+    }
+    sub->borrowed = 0;
+    topic_pass(sub->topic, sub->cursor++);
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
+// recebe a proxima mensagem do assinante (copia sobre topic_peek/topic_release)
+int topic_recv(topic_sub_t* sub, void* msg) {
+    const void* slot;
+    if (msg == NULL || (slot = topic_peek(sub)) == NULL) {
+        return -1;
+    }
+    memcpy(msg, slot, sub->topic->messageSize);
+    return topic_release(sub);
+}
+
+// destroi o topico, liberando publicadores e assinantes bloqueados
+int topic_destroy(topic_t* topic) {
+    if (topic == NULL || !(topic->active)) {
+        return -1;
+    }
+    PPOS_PREEMPT_DISABLE;
+    topic->active = 0;
+    task_queue_splice(&readyQueue, &(topic->pubQueue), CORE_TASK_STATE_READY);
+    task_queue_splice(&readyQueue, &(topic->subQueue), CORE_TASK_STATE_READY);
+    free(topic->content);
+    free(topic->refs);
+    topic->content = NULL;
+    topic->refs = NULL;
+    topic->subs = NULL;
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
+// semaforo que indica se o objeto de ppos_wait_any esta pronto
+static semaphore_t* wait_any_sem(ppos_object_t* object) {
+    if (object->obj == NULL) {
+        return NULL;
+    }
+    switch (object->type) {
+    case PPOS_OBJ_SEM:
+        return (semaphore_t*) object->obj;
+    case PPOS_OBJ_MQUEUE:
+        return &(((mqueue_t*) object->obj)->sItem);
+    default:
+        return NULL;
+    }
+}
+
+// aguarda ate que um dos objetos fique pronto; a tarefa se registra na
+// lista de observadores do semaforo de cada objeto e e acordada pelo
+// primeiro sem_up que deixar unidades disponiveis, sem consulta periodica.
+// Um objeto destruido, antes ou durante a espera, resulta em -1, como
+// sem_down ou mqueue_recv sobre ele
+int ppos_wait_any(ppos_object_t objects[], int n, int timeout) {
+    task_t* waitQueue = NULL;
+    int fired = -1;
+    int i;
+
+    if (objects == NULL || n <= 0) {
+        return -1;
+    }
+    semwatch_t watch[n];
+
+    PPOS_PREEMPT_DISABLE;
+    for (i = 0; i < n; i++) {
+        semaphore_t* s = wait_any_sem(&objects[i]);
+        if (s == NULL) {
+            PPOS_PREEMPT_ENABLE;
+            return -1;
+        }
+        if (!(s->active)) {
+            PPOS_PREEMPT_ENABLE;
+            return -1;
+        }
+        if (s->queue == NULL && s->counter > 0) {
+            PPOS_PREEMPT_ENABLE;
+            return i;
+        }
+    }
+    if (timeout == 0) {
+        PPOS_PREEMPT_ENABLE;
+        return -1;
+    }
+
+    for (i = 0; i < n; i++) {
+        semaphore_t* s = wait_any_sem(&objects[i]);
+        watch[i].sem = s;
+        watch[i].task = taskExec;
+        watch[i].index = i;
+        watch[i].fired = &fired;
+        watch[i].prev = NULL;
+        watch[i].next = s->watchers;
+        if (s->watchers != NULL) {
+            s->watchers->prev = &watch[i];
+        }
+        s->watchers = &watch[i];
+    }
+
+    // com timeout, a tarefa aguarda na fila de tarefas dormindo do nucleo,
+    // que a acorda quando o prazo expira
+    if (timeout > 0) {
+        taskExec->awakeTime = systime() + timeout;
+        task_suspend(taskExec, &sleepQueue);
+    } else {
+        task_suspend(taskExec, &waitQueue);
+    }
+    PPOS_PREEMPT_ENABLE;
+    task_yield();
+
+    PPOS_PREEMPT_DISABLE;
+    // registros de semaforos destruidos ja foram desligados por sem_destroy
+    if (fired >= 0 && watch[fired].sem == NULL) {
+        fired = -1;
+    }
+    for (i = 0; i < n; i++) {
+        semaphore_t* s = watch[i].sem;
+        if (s == NULL) {
+            continue;
+        }
+        if (watch[i].prev != NULL) {
+            watch[i].prev->next = watch[i].next;
+        } else {
+            s->watchers = watch[i].next;
+        }
+        if (watch[i].next != NULL) {
+            watch[i].next->prev = watch[i].prev;
+        }
+    }
+    PPOS_PREEMPT_ENABLE;
+    return fired;
+}
+
 int before_mqueue_create (mqueue_t *queue, int max, int size) {
     // put your customization here
 #ifdef DEBUG
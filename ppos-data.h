@@ -30,15 +30,37 @@ typedef struct task_t
    int running_time;
    int launch_timestamp;
    unsigned int activations;
+   unsigned char sys_task;          // tarefa de sistema (ex.: gerente de disco)
+   int prio;                        // prioridade estatica (task_setprio/task_getprio)
+   void* wait_data;                 // dados da espera em curso (na pilha da tarefa bloqueada)
 
 } task_t ;
 
 
+// faixa de prioridades das tarefas (valores menores sao mais prioritarios)
+#define PPOS_PRIO_MAX    -20
+#define PPOS_PRIO_MIN     20
+#define PPOS_PRIO_LEVELS (PPOS_PRIO_MIN - PPOS_PRIO_MAX + 1)
+
+// ordem de atendimento das tarefas em espera em semaforos e mqueues
+#define PPOS_WAIT_FIFO 0            // ordem de chegada (padrao)
+#define PPOS_WAIT_PRIO 1            // prioridade da tarefa; FIFO entre iguais
+
+// indice por prioridade de uma fila de espera: ultima tarefa de cada nivel
+// e mapa de bits dos niveis nao vazios, para inserir sem percorrer a fila
+typedef struct {
+    struct task_t *tail[PPOS_PRIO_LEVELS];
+    unsigned long long levels;
+} waitindex_t ;
+
 // estrutura que define um semáforo
 typedef struct {
     struct task_t *queue;
-    int counter;
+    int counter;                    // unidades disponiveis (nunca negativo)
     unsigned char active;
+    unsigned char order;            // PPOS_WAIT_FIFO ou PPOS_WAIT_PRIO
+    waitindex_t *index;             // usado somente na ordem PPOS_WAIT_PRIO
+    struct semwatch_t *watchers;    // registros de ppos_wait_any neste semaforo
 } semaphore_t ;
 
 // estrutura que define um mutex
@@ -49,28 +71,93 @@ typedef struct {
     unsigned char active;
 } mutex_t ;
 
-// estrutura que define uma barreira
+// estrutura que define uma variavel de condicao
+typedef struct {
+    struct task_t *queue;
+    mutex_t *mutex;                 // mutex associado (definido no primeiro cond_wait)
+    unsigned char active;
+} cond_t ;
+
+// numero de faixas do histograma de espera das barreiras (potencias de 2, em ms)
+#define BARRIER_HIST_BUCKETS 16
+
+// estrutura que define uma barreira (sense-reversing, reutilizavel)
 typedef struct {
     struct task_t *queue;
     int maxTasks;
-    int countTasks;
+    int countTasks;                 // tarefas que ainda faltam chegar na fase atual
+    unsigned char sense;            // sentido da fase atual, invertido a cada liberacao
     unsigned char active;
-    mutex_t mutex;
+    unsigned int phases;            // numero de fases concluidas
+    unsigned int phaseStart;        // chegada da primeira tarefa na fase atual
+    unsigned int waitHist[BARRIER_HIST_BUCKETS]; // espera por fase (1a chegada -> liberacao)
 } barrier_t ;
 
-// estrutura que define uma fila de mensagens
+// niveis de prioridade de mqueue_send_prio (0 = menos urgente)
+#define MQUEUE_PRIO_LEVELS 8
+
+// estrutura que define uma fila de mensagens (buffer circular)
 typedef struct {
     void* content;
     int messageSize;
     int maxMessages;
     int countMessages;
-    
-    semaphore_t sBuffer;
+    int head;                       // proxima mensagem a ser entregue a um receptor
+    int tail;                       // proxima posicao livre a ser reservada
+    int prodPending;                // posicoes reservadas ainda nao publicadas (antes de tail)
+    int consPending;                // mensagens emprestadas ainda nao liberadas (antes de head)
+    struct task_t **slotOwner;      // tarefa que reservou/emprestou cada posicao
+    unsigned char varlen;           // mensagens de tamanho variavel: content e um
+                                    // anel de bytes, maxMessages e a capacidade em
+                                    // bytes e head/tail sao deslocamentos em bytes
+    struct mqprio_t *prio;          // anel de posicoes por nivel (mqueue_create_prio)
+
     semaphore_t sItem;
     semaphore_t sVaga;
     
     unsigned char active;
 } mqueue_t ;
 
+// politicas de topic_t para um assinante lento, quando o anel esta cheio
+#define TOPIC_BLOCK       0         // o publicador aguarda o assinante liberar posicoes
+#define TOPIC_DROP_OLDEST 1         // descarta a mensagem mais antiga para os atrasados
+
+// topico publica/assina: cada mensagem e escrita uma unica vez no anel e lida
+// por todos os assinantes; as posicoes sao contadas por numero de sequencia
+typedef struct {
+    void* content;
+    int messageSize;
+    int maxMessages;
+    unsigned long head;             // sequencia da mensagem mais antiga retida
+    unsigned long tail;             // sequencia da proxima mensagem publicada
+    int *refs;                      // assinantes que ainda nao passaram de cada posicao
+    int policy;                     // TOPIC_BLOCK ou TOPIC_DROP_OLDEST
+    int countSubs;
+    struct topic_sub_t *subs;       // lista de assinantes
+    struct task_t *pubQueue;        // publicadores aguardando posicao livre
+    struct task_t *subQueue;        // assinantes aguardando nova mensagem
+    unsigned char active;
+} topic_t ;
+
+// assinatura de um topic_t, com o cursor de leitura proprio do assinante
+typedef struct topic_sub_t {
+    struct topic_sub_t *prev, *next;
+    topic_t *topic;
+    unsigned long cursor;           // sequencia da proxima mensagem a ler
+    unsigned long dropped;          // mensagens descartadas antes de serem lidas
+    unsigned char borrowed;         // mensagem do cursor emprestada por topic_peek
+    unsigned char active;
+} topic_sub_t ;
+
+// tipos de objeto aceitos por ppos_wait_any
+#define PPOS_OBJ_SEM    0           // pronto quando sem_down nao bloquearia
+#define PPOS_OBJ_MQUEUE 1           // pronto quando ha mensagem para receber
+
+// objeto a ser aguardado por ppos_wait_any
+typedef struct {
+    int type;                       // PPOS_OBJ_SEM ou PPOS_OBJ_MQUEUE
+    void *obj;                      // semaphore_t* ou mqueue_t*
+} ppos_object_t ;
+
 #endif
 
@@ -4,8 +4,10 @@
 #include "ppos-disk-manager.h"
 
 #include <errno.h>
+#include <limits.h>
 #include <signal.h>
 #include <string.h>
+#include <strings.h>
 #include <sys/time.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -15,13 +17,62 @@
    ============================================================
  */
 
-// Filas de requisições e tarefas suspensas 
-static task_t *disk_suspended_queue = NULL;
-static diskrequest_t *disk_task_queue = NULL;
+// Filas de requisicoes pendentes, uma por tipo (leitura e escrita), em ordem
+// de chegada: insercao e remocao em O(1), e a mais antiga de cada tipo (para
+// os prazos) e a primeira da sua fila. As tarefas solicitantes nao ficam em
+// uma lista a parte: cada uma aguarda suspensa na sua propria requisicao
+// (waitQueue), ate o estado dela chegar a DISK_REQ_DONE
+QUEUE_DECLARE(diskqueue, diskrequest_t)
+static diskqueue_t disk_task_queue[DISK_REQ_TYPES];
+static unsigned long disk_req_seq = 0;
 static diskrequest_t *current_disk_task = NULL;
 
+#define DISK_REQ_TYPE(op) ((op) == DISK_CMD_WRITE ? DISK_REQ_WRITE : DISK_REQ_READ)
+
+// Conjunto de blocos em bitmap hierarquico: no nivel 0 ha um bit por bloco;
+// em cada nivel acima, um bit por palavra nao nula do nivel abaixo. Achar o
+// proximo ou o anterior bloco do conjunto custa O(log64 num_blocks)
+#define DISK_MAP_BITS 64
+#define DISK_MAP_MAX_LEVELS 6
+typedef struct {
+    unsigned long *words[DISK_MAP_MAX_LEVELS];
+    int size[DISK_MAP_MAX_LEVELS];  // palavras em cada nivel
+    int levels;
+} diskmap_t;
+
+// Indice das requisicoes pendentes por bloco, usado por SSTF e C-SCAN: cada
+// bloco tem a fila (FIFO) das suas requisicoes, e disk_block_map marca os
+// blocos com requisicoes
+typedef struct {
+    diskrequest_t *first;
+    diskrequest_t *last;
+} diskbucket_t;
+static diskbucket_t *disk_block_index = NULL;
+static diskmap_t disk_block_map;
+
+// Escalonamento: politica configurada, sentido da varredura (SCAN e LOOK)
+// e media movel do deslocamento por requisicao (modo adaptativo)
+#define DISK_ADAPT_DEEP  8     // fila profunda: C-LOOK garante espera uniforme
+#define DISK_ADAPT_NEAR 16     // deslocamento medio < num_blocks/16: acessos locais
+static int disk_sched_policy = DISK_SCHED_FCFS;
+static int disk_deadline[DISK_REQ_TYPES] = { DISK_DEADLINE_READ, DISK_DEADLINE_WRITE };
+
+// Histograma da espera na fila por tipo: valores ate 7 ms exatos; acima,
+// cada potencia de 2 e dividida em 8 faixas (erro relativo < 1/8)
+#define DISK_WAIT_SUB     8
+#define DISK_WAIT_BUCKETS (30 * DISK_WAIT_SUB)
+static int disk_wait_hist[DISK_REQ_TYPES][DISK_WAIT_BUCKETS];
+static int disk_sched_dir = 1;
+static int disk_seek_avg = 0;
+
+// SCAN e C-SCAN: bordas do disco por onde a cabeca passa antes do bloco
+// escolhido e, no SCAN, o sentido da varredura apos a borda; so sao
+// aplicados quando a requisicao escolhida e de fato despachada
+static int disk_sched_via[2];
+static int disk_sched_vias = 0;
+static int disk_sched_via_dir = 0;
+
 // Semáforos para sincronização 
-static semaphore_t disk_mgr_sem;
 static semaphore_t disk_task_sem;
 
 // Tarefa do gerenciador de disco 
@@ -30,21 +81,145 @@ static task_t disk_mgr_task;
 // Informações do disco 
 static disk_t disk;
 
+// Slab de requisicoes: as requisicoes livres ficam encadeadas por next;
+// quando o slab esgota, cresce DISK_REQ_SLAB_CHUNK requisicoes de uma vez,
+// que nunca sao devolvidas ao malloc
+#define DISK_REQ_SLAB_CHUNK 32
+static diskrequest_t *disk_req_free = NULL;
+
+// Cache de blocos: buffers de tamanho fixo, achados por uma tabela hash
+// indexada pelo numero do bloco e substituidos pelo algoritmo do relogio
+// (CLOCK): o ponteiro percorre os buffers em circulo, dando uma segunda
+// chance aos referenciados desde a ultima passada. Um buffer em leitura
+// (busy) fica na tabela, e quem o procura aguarda na sua fila. Buffers
+// sujos nunca sao substituidos: saem do cache so depois de gravados; nem
+// os fixados, cujo endereco foi entregue por disk_block_get
+typedef struct diskbuf_t {
+    struct diskbuf_t *hashNext;   // proximo buffer na mesma posicao da tabela
+    int block;                    // bloco guardado, ou -1 se livre
+    unsigned char valid;          // conteudo e o bloco mais recente
+    unsigned char busy;           // leitura do disco em andamento
+    unsigned char ref;            // referenciado desde a ultima passada do CLOCK
+    unsigned char dirty;          // alterado e ainda nao gravado no disco
+    unsigned char writing;        // gravacao do disco em andamento (conteudo fixo)
+    unsigned char wpin;           // fixado para escrita (exclusivo)
+    int pins;                     // tarefas com o bloco fixado (disk_block_get)
+    unsigned char ahead;          // lido antecipadamente e ainda nao usado
+    unsigned char stream;         // sequencia que o antecipou (se ahead)
+    int ahead_latency;            // atendimento da leitura antecipada, em ms
+    unsigned char *data;
+    task_t *waitQueue;            // tarefas aguardando o fim da leitura ou gravacao
+} diskbuf_t;
+
+static int disk_cache_size = DISK_CACHE_DEFAULT;
+static diskbuf_t *disk_cache = NULL;
+static diskbuf_t **disk_cache_hash = NULL;
+static int disk_cache_mask = 0;   // tamanho da tabela hash - 1
+static int disk_cache_hand = 0;   // ponteiro do CLOCK
+
+// Escrita adiada: disk_block_write so copia o bloco para o cache e o marca
+// sujo em disk_dirty_map. A tarefa de descarga grava os sujos em varreduras
+// crescentes de bloco (ordem de elevador), quando eles passam do limite
+// BACKGROUND ou apos DISK_FLUSH_INTERVAL; no limite LIMIT, os escritores de
+// blocos novos aguardam em disk_throttle_queue ate a descarga liberar buffers
+static int disk_write_back = DISK_WRITE_BACK_DEFAULT;
+static int disk_dirty_ratio[2] = { DISK_DIRTY_BACKGROUND, DISK_DIRTY_LIMIT };
+static diskmap_t disk_dirty_map;
+static task_t disk_flush_task;
+static int disk_flush_cursor = 0;  // proximo bloco da varredura da descarga
+static task_t *disk_throttle_queue = NULL;
+
+// Leitura antecipada: cada tarefa que le do disco tem uma sequencia
+// (stream), numa tabela pequena com substituicao LRU. Uma leitura do bloco
+// seguinte ao ultimo lido prolonga a sequencia; apos o gatilho, os blocos
+// ate window alem do lido sao pedidos ao gerente sem tarefa esperando, em
+// buffers do cache marcados em leitura (busy), e quem os procura aguarda
+// como em uma falta. frontier e o ultimo bloco ja antecipado
+#define DISK_RA_STREAMS 8
+typedef struct {
+    task_t *task;
+    int next;                     // bloco que continua a sequencia
+    int run;                      // leituras consecutivas
+    int window;                   // blocos antecipados alem do lido
+    int frontier;
+    unsigned long used;           // ultimo uso, para a substituicao
+} diskstream_t;
+static int disk_ra_max = DISK_READAHEAD_DEFAULT;
+static diskstream_t disk_ra_stream[DISK_RA_STREAMS];
+static unsigned long disk_ra_clock = 0;
+
 // Controle de sinais 
 static struct sigaction disk_sig;
 static volatile int disk_sig_flag = 0;  // Volatile pois é modificada no handler 
 
+// O gerente aguarda trabalho estacionado na fila de tarefas dormindo, com
+// despertar "infinito"; quem o acorda apenas zera seu despertar, e o
+// dispatcher o devolve aos prontos. Assim o tratador do sinal do disco nao
+// mexe em filas do nucleo, que podem estar sendo alteradas pela tarefa
+// interrompida
+static volatile int disk_mgr_pending = 0;  // ha requisicao nova a examinar
+
 /* ============================================================
  * Protótipos de Funções Auxiliares
    ============================================================
  */
 
-// Manipulação de filas 
-static void append_disk_task(diskrequest_t *request);
-static void add_task_to_suspended_queue(task_t *task);
-static void add_task_to_ready_queue(task_t *task);
-static task_t *remove_task_from_suspended_queue(task_t *task);
-static diskrequest_t *remove_disk_request(diskrequest_t *request);
+// Fila e indice de requisicoes pendentes 
+static int disk_index_init(int num_blocks);
+static void enqueue_disk_request(diskrequest_t *request);
+static diskrequest_t *dequeue_disk_request(diskrequest_t *request);
+static int disk_index_next(int block);
+static int disk_index_prev(int block);
+
+// Conjuntos de blocos (bitmap hierarquico)
+static int disk_map_init(diskmap_t *map, int num_blocks);
+static void disk_map_set(diskmap_t *map, int block);
+static void disk_map_clear(diskmap_t *map, int block);
+static int disk_map_next(diskmap_t *map, int block);
+static int disk_map_prev(diskmap_t *map, int block);
+
+// Estatisticas de espera na fila 
+static void disk_wait_record(int type, int wait);
+static int disk_wait_percentile(int type, int permille);
+
+// Conclusao de requisicoes 
+static void complete_disk_request(diskrequest_t *request, int status);
+
+// Cache de blocos 
+static int disk_cache_init(void);
+static diskbuf_t *disk_cache_lookup(int block);
+static diskbuf_t *disk_cache_victim(int spare);
+static void disk_cache_insert(diskbuf_t *buf, int block);
+static void disk_cache_drop(diskbuf_t *buf);
+static void disk_cache_wait(diskbuf_t *buf);
+static diskbuf_t *disk_cache_fetch(int block, int flags, diskstream_t *stream, int *extend);
+static int disk_cache_read(int block, void *buffer);
+static diskbuf_t *disk_cache_get(int block, int flags);
+static diskbuf_t *disk_cache_get_write(int block, int flags);
+static int disk_cache_put(diskbuf_t *buf);
+static int disk_cache_write(int block, void *buffer);
+static int disk_cache_write_back(int block, void *buffer);
+static void disk_cache_mark_dirty(diskbuf_t *buf);
+static int disk_dirty_full(void);
+static void disk_dirty_throttle(int *throttled);
+static int disk_cache_flush(diskbuf_t *buf);
+static int disk_dirty_blocks(int ratio);
+
+// Leitura antecipada
+static diskstream_t *disk_stream_find(void);
+static diskstream_t *disk_stream_note(int block);
+static int disk_readahead_window(void);
+static void disk_readahead(diskstream_t *stream, int block);
+static void disk_readahead_done(diskrequest_t *request);
+
+// Tarefa de descarga dos blocos sujos
+static void disk_flusher(void *args);
+static void disk_flush_wait(void);
+static void disk_flush_sleep(unsigned int awake);
+
+// Espera e despertar do gerente 
+static void disk_mgr_wait(void);
+static void disk_mgr_wakeup(void);
 
 // Manipulação de sinais 
 static int setup_disk_signal_handler(void);
@@ -53,10 +228,25 @@ static void disk_signal_handler(int signum);
 // Função auxiliar para criar requisição de disco 
 static diskrequest_t *create_disk_request(int op, int block, void *buffer, task_t *task);
 
+// Slab de requisicoes
+static int disk_request_slab_grow(void);
+static diskrequest_t *disk_request_alloc(void);
+static void disk_request_free(diskrequest_t *request);
+
 // Escalonadores
-static diskrequest_t *fcfs_scheduler(diskrequest_t *queue);
-static diskrequest_t *sstf_scheduler(diskrequest_t *queue);
-static diskrequest_t *cscan_scheduler(diskrequest_t *queue);
+static diskrequest_t *fcfs_scheduler(void);
+static diskrequest_t *sstf_scheduler(void);
+static diskrequest_t *scan_scheduler(void);
+static diskrequest_t *cscan_scheduler(void);
+static diskrequest_t *look_scheduler(void);
+static diskrequest_t *clook_scheduler(void);
+static diskrequest_t *deadline_scheduler(void);
+static int adaptive_policy(void);
+static int disk_pending(void);
+static void disk_sched_seek(int block);
+static void disk_sched_pass(int block);
+static void disk_sched_travel(void);
+static int disk_sweep_next(int dir);
 
 // Função comum para operações de leitura e escrita 
 static int disk_block_operation(int op, int block, void *buffer);
@@ -84,32 +274,49 @@ void disk_manager(void *args) {
 
         // Se o sinal do disco foi recebido, conclui a tarefa corrente 
         if (disk_sig_flag) {
-            task_t *ready_task = remove_task_from_suspended_queue(current_disk_task->task);
-            add_task_to_ready_queue(ready_task);
-
             disk_sig_flag = 0;
 
-            disk.total_steps += abs(disk.head_position - current_disk_task->block);
-            disk.total_time += systime() - current_disk_task->start_time;
+            int steps = abs(disk.head_position - current_disk_task->block);
+            int time = systime() - current_disk_task->start_time;
+            int policy = current_disk_task->policy;
+
+            disk.total_steps += steps;
+            disk.total_time += time;
             disk.head_position = current_disk_task->block;
+            disk.sched_requests[policy]++;
+            disk.sched_steps[policy] += steps;
+            disk.sched_time[policy] += time;
+            disk_seek_avg += (steps - disk_seek_avg) / 4;
 
-            free(current_disk_task);
+            // a requisicao pertence a tarefa solicitante a partir daqui
+            complete_disk_request(current_disk_task, DISK_REQ_DONE);
             current_disk_task = NULL;
         }
 
-        // Se o disco está ocioso e há requisições pendentes 
+        // Se o disco está ocioso e há requisições pendentes; so despacha sem
+        // requisicao em atendimento, pois o sinal de conclusao pode chegar
+        // depois do teste acima, com o disco ja ocioso
         int disk_idle = (disk_cmd(DISK_CMD_STATUS, 0, 0) == DISK_STATUS_IDLE);
-        if (disk_idle && disk_task_queue != NULL) {
-            // * Pode-se alternar entre os escalonadores: fcfs, sstf, cscan ==================================================================// 
-            diskrequest_t *next_request = fcfs_scheduler(disk_task_queue); 
+        if (disk_idle && current_disk_task == NULL && disk_pending() > 0) {
+            // A politica e escolhida por disk_set_scheduler ou PPOS_DISK_SCHED
+            diskrequest_t *next_request = disk_scheduler();
             if (disk_cmd(next_request->op, next_request->block, next_request->buffer) >= 0) {
-                current_disk_task = remove_disk_request(next_request);
+                disk_sched_travel();
+                current_disk_task = dequeue_disk_request(next_request);
+                current_disk_task->status = DISK_REQ_SERVING;
+                current_disk_task->policy = disk.sched_active;
                 current_disk_task->start_time = systime();
+                disk_wait_record(DISK_REQ_TYPE(current_disk_task->op),
+                                 current_disk_task->start_time - current_disk_task->launch_time);
+            } else {
+                // recusada pelo disco: reenvia-la a cada volta nao a faria
+                // ser aceita; o solicitante recebe o erro
+                complete_disk_request(dequeue_disk_request(next_request), DISK_REQ_FAILED);
             }
         }
 
         sem_up(&disk_task_sem);
-        sem_down(&disk_mgr_sem);
+        disk_mgr_wait();
     }
 }
 
@@ -121,14 +328,11 @@ void disk_manager(void *args) {
 int disk_mgr_init(int *numblocks, int *blockSize) {
     PPOS_PREEMPT_DISABLE;
 
-    disk_suspended_queue = NULL;
-    disk_task_queue = NULL;
+    for (int type = 0; type < DISK_REQ_TYPES; type++)
+        diskqueue_init(&disk_task_queue[type]);
     disk_sig_flag = 0;
 
-    if (sem_create(&disk_mgr_sem, 0) < 0) {
-        PPOS_PREEMPT_ENABLE;
-        return -1;
-    }
+    disk_mgr_pending = 0;
     if (sem_create(&disk_task_sem, 1) < 0) {
         PPOS_PREEMPT_ENABLE;
         return -1;
@@ -155,6 +359,88 @@ int disk_mgr_init(int *numblocks, int *blockSize) {
     disk.total_steps = 0;
     disk.head_position = 0;
 
+    // politica inicial: PPOS_DISK_SCHED, se definida, ou a ja configurada
+    char *sched = getenv("PPOS_DISK_SCHED");
+    if (sched != NULL) {
+        int policy;
+        for (policy = 0; policy <= DISK_SCHED_ADAPTIVE; policy++)
+            if (strcasecmp(sched, disk_sched_name(policy)) == 0)
+                break;
+        if (policy > DISK_SCHED_ADAPTIVE) {
+            fprintf(stderr, "PPOS_DISK_SCHED: politica desconhecida \"%s\"\n", sched);
+            PPOS_PREEMPT_ENABLE;
+            return -1;
+        }
+        disk_sched_policy = policy;
+    }
+    disk.sched_policy = disk_sched_policy;
+    disk.deadline[DISK_REQ_READ] = disk_deadline[DISK_REQ_READ];
+    disk.deadline[DISK_REQ_WRITE] = disk_deadline[DISK_REQ_WRITE];
+    disk.sched_active = disk_sched_policy == DISK_SCHED_ADAPTIVE ? DISK_SCHED_FCFS : disk_sched_policy;
+
+    if (disk_req_free == NULL && disk_request_slab_grow() < 0) {
+        PPOS_PREEMPT_ENABLE;
+        return -1;
+    }
+    if (disk_index_init(disk.num_blocks) < 0) {
+        PPOS_PREEMPT_ENABLE;
+        return -1;
+    }
+
+    // capacidade do cache: PPOS_DISK_CACHE, se definida, ou a ja configurada
+    char *cache = getenv("PPOS_DISK_CACHE");
+    if (cache != NULL) {
+        char *end;
+        long blocks = strtol(cache, &end, 10);
+        if (end == cache || *end != '\0' || blocks < 0 || blocks > disk.num_blocks) {
+            fprintf(stderr, "PPOS_DISK_CACHE: capacidade invalida \"%s\"\n", cache);
+            PPOS_PREEMPT_ENABLE;
+            return -1;
+        }
+        disk_cache_size = blocks;
+    }
+    if (disk_cache_init() < 0) {
+        PPOS_PREEMPT_ENABLE;
+        return -1;
+    }
+
+    // escrita adiada: PPOS_DISK_WRITEBACK, se definida, ou a ja configurada
+    char *write_back = getenv("PPOS_DISK_WRITEBACK");
+    if (write_back != NULL) {
+        if (strcmp(write_back, "0") != 0 && strcmp(write_back, "1") != 0) {
+            fprintf(stderr, "PPOS_DISK_WRITEBACK: valor invalido \"%s\"\n", write_back);
+            PPOS_PREEMPT_ENABLE;
+            return -1;
+        }
+        disk_write_back = write_back[0] - '0';
+    }
+    disk.dirty_background = disk_dirty_ratio[0];
+    disk.dirty_limit = disk_dirty_ratio[1];
+    disk.cache_write_back = 0;
+    if (disk.cache_capacity > 0 && disk_write_back) {
+        if (disk_map_init(&disk_dirty_map, disk.num_blocks) < 0 ||
+            task_create(&disk_flush_task, disk_flusher, NULL) < 0) {
+            PPOS_PREEMPT_ENABLE;
+            return -1;
+        }
+        disk_flush_task.sys_task = 1;
+        disk.cache_write_back = 1;
+    }
+
+    // leitura antecipada: PPOS_DISK_READAHEAD, se definida, ou a ja configurada
+    char *readahead = getenv("PPOS_DISK_READAHEAD");
+    if (readahead != NULL) {
+        char *end;
+        long blocks = strtol(readahead, &end, 10);
+        if (end == readahead || *end != '\0' || blocks < 0 || blocks > disk.num_blocks) {
+            fprintf(stderr, "PPOS_DISK_READAHEAD: janela invalida \"%s\"\n", readahead);
+            PPOS_PREEMPT_ENABLE;
+            return -1;
+        }
+        disk_ra_max = blocks;
+    }
+    disk.ra_max = disk_ra_max;
+
     *numblocks = disk.num_blocks;
     *blockSize = disk.block_size;
 
@@ -171,29 +457,193 @@ int disk_mgr_init(int *numblocks, int *blockSize) {
 
 /* Função comum para operações de leitura e escrita */
 static int disk_block_operation(int op, int block, void *buffer) {
-    task_t *current_task = taskExec;  /* Tarefa corrente */
+    // o indice por bloco so comporta blocos existentes
+    if (block < 0 || block >= disk.num_blocks || buffer == NULL)
+        return -1;
 
-    diskrequest_t *request = create_disk_request(op, block, buffer, current_task);
+    diskrequest_t *request = create_disk_request(op, block, buffer, taskExec);
 
     sem_down(&disk_task_sem);
-    append_disk_task(request);
-    add_task_to_suspended_queue(current_task);
+    enqueue_disk_request(request);
     sem_up(&disk_task_sem);
 
-    sem_up(&disk_mgr_sem);
-    task_switch(taskDisp);
+    disk_mgr_wakeup();
 
-    return 0;
+    // aguarda suspensa na propria requisicao ate o gerente conclui-la
+    PPOS_PREEMPT_DISABLE;
+    while (request->status != DISK_REQ_DONE && request->status != DISK_REQ_FAILED) {
+        task_suspend(taskExec, &(request->waitQueue));
+        PPOS_PREEMPT_ENABLE;
+        task_yield();
+        PPOS_PREEMPT_DISABLE;
+    }
+    PPOS_PREEMPT_ENABLE;
+
+    int result = (request->status == DISK_REQ_DONE) ? 0 : -1;
+    disk_request_free(request);
+    return result;
 }
 
 int disk_block_read(int block, void *buffer) {
+    if (disk.cache_capacity > 0 && block >= 0 && block < disk.num_blocks && buffer != NULL)
+        return disk_cache_read(block, buffer);
     return disk_block_operation(DISK_CMD_READ, block, buffer);
 }
 
+// com escrita adiada, a escrita termina no cache; sem ela (write-through),
+// a copia no cache e a do disco sao atualizadas juntas
 int disk_block_write(int block, void *buffer) {
+    if (disk.cache_capacity > 0 && block >= 0 && block < disk.num_blocks && buffer != NULL) {
+        if (disk.cache_write_back)
+            return disk_cache_write_back(block, buffer);
+        return disk_cache_write(block, buffer);
+    }
     return disk_block_operation(DISK_CMD_WRITE, block, buffer);
 }
 
+int disk_block_sync(int block) {
+    diskbuf_t *buf;
+    int result = 0;
+
+    if (block < 0 || block >= disk.num_blocks)
+        return -1;
+    if (!disk.cache_write_back)
+        return 0;
+    PPOS_PREEMPT_DISABLE;
+    if ((buf = disk_cache_lookup(block)) != NULL)
+        result = disk_cache_flush(buf);
+    PPOS_PREEMPT_ENABLE;
+    return result;
+}
+
+// uma unica varredura crescente; blocos sujos depois de passar por eles
+// ficam para a descarga
+int disk_sync(void) {
+    int block = 0, result = 0;
+
+    if (!disk.cache_write_back)
+        return 0;
+    PPOS_PREEMPT_DISABLE;
+    while ((block = disk_map_next(&disk_dirty_map, block)) >= 0) {
+        if (disk_cache_flush(disk_cache_lookup(block)) < 0)
+            result = -1;
+        block++;
+    }
+    PPOS_PREEMPT_ENABLE;
+    return result;
+}
+
+const void *disk_block_get(int block, int flags) {
+    diskbuf_t *buf;
+
+    if (disk.cache_capacity == 0 || block < 0 || block >= disk.num_blocks)
+        return NULL;
+    buf = disk_cache_get(block, flags);
+    return buf != NULL ? buf->data : NULL;
+}
+
+void *disk_block_get_for_write(int block, int flags) {
+    diskbuf_t *buf;
+
+    if (disk.cache_capacity == 0 || block < 0 || block >= disk.num_blocks)
+        return NULL;
+    buf = disk_cache_get_write(block, flags);
+    return buf != NULL ? buf->data : NULL;
+}
+
+// o buffer e achado pela posicao do endereco na area de dados do cache,
+// alocada de uma vez em disk_cache_init
+int disk_block_put(const void *data) {
+    const unsigned char *base;
+    long offset;
+
+    if (disk.cache_capacity == 0 || data == NULL)
+        return -1;
+    base = disk_cache[0].data;
+    offset = (const unsigned char *) data - base;
+    if (offset < 0 || offset >= (long) disk.cache_capacity * disk.block_size ||
+        offset % disk.block_size != 0)
+        return -1;
+    return disk_cache_put(&disk_cache[offset / disk.block_size]);
+}
+
+int disk_set_cache_size(int blocks) {
+    if (blocks < 0 || disk_cache != NULL)
+        return -1;
+    disk_cache_size = blocks;
+    return 0;
+}
+
+int disk_set_write_back(int enable) {
+    if ((enable != 0 && enable != 1) || disk_cache != NULL)
+        return -1;
+    disk_write_back = enable;
+    return 0;
+}
+
+int disk_set_readahead(int max_blocks) {
+    if (max_blocks < 0)
+        return -1;
+    PPOS_PREEMPT_DISABLE;
+    disk_ra_max = disk.ra_max = max_blocks;
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
+int disk_set_dirty_ratio(int background, int limit) {
+    if (background <= 0 || background > limit || limit > 100)
+        return -1;
+    PPOS_PREEMPT_DISABLE;
+    disk_dirty_ratio[0] = disk.dirty_background = background;
+    disk_dirty_ratio[1] = disk.dirty_limit = limit;
+    // os novos limites podem ja ter sido alcancados
+    if (disk.cache_write_back && disk.cache_dirty >= disk_dirty_blocks(background))
+        disk_flush_task.awakeTime = 0;
+    while (disk_throttle_queue != NULL)
+        task_resume(disk_throttle_queue);
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
+int disk_set_scheduler(int policy) {
+    if (policy < 0 || policy > DISK_SCHED_ADAPTIVE)
+        return -1;
+    PPOS_PREEMPT_DISABLE;
+    disk_sched_policy = policy;
+    disk.sched_policy = policy;
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
+int disk_set_deadline(int read_ms, int write_ms) {
+    if (read_ms <= 0 || write_ms <= 0)
+        return -1;
+    PPOS_PREEMPT_DISABLE;
+    disk_deadline[DISK_REQ_READ] = disk.deadline[DISK_REQ_READ] = read_ms;
+    disk_deadline[DISK_REQ_WRITE] = disk.deadline[DISK_REQ_WRITE] = write_ms;
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
+const char *disk_sched_name(int policy) {
+    static const char *names[] = { "fcfs", "sstf", "scan", "cscan", "look", "clook",
+                                   "deadline", "adaptive" };
+    if (policy < 0 || policy > DISK_SCHED_ADAPTIVE)
+        return NULL;
+    return names[policy];
+}
+
+int disk_mgr_stats(disk_t *stats) {
+    if (stats == NULL)
+        return -1;
+    PPOS_PREEMPT_DISABLE;
+    for (int type = 0; type < DISK_REQ_TYPES; type++)
+        disk.wait_p99[type] = disk_wait_percentile(type, 990);
+    *stats = disk;
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
 /* ============================================================
  * Configuração do Manipulador de Sinais
    ============================================================
@@ -212,7 +662,36 @@ static int setup_disk_signal_handler(void) {
 static void disk_signal_handler(int signum) {
     (void)signum;  // Evita warning de variável não utilizada 
     disk_sig_flag = 1;
-    sem_up(&disk_mgr_sem);
+    disk_mgr_task.awakeTime = 0;
+}
+
+/* ============================================================
+ * Espera e Despertar do Gerenciador
+   ============================================================
+ */
+
+// Estaciona o gerente ate haver requisicao nova ou sinal do disco; o
+// despertar e armado antes de testar as condicoes, para que um sinal
+// recebido depois do teste nao se perca
+static void disk_mgr_wait(void) {
+    PPOS_PREEMPT_DISABLE;
+    disk_mgr_task.awakeTime = UINT_MAX;
+    if (!disk_mgr_pending && !disk_sig_flag) {
+        task_suspend(taskExec, &sleepQueue);
+        PPOS_PREEMPT_ENABLE;
+        task_yield();
+        PPOS_PREEMPT_DISABLE;
+    }
+    disk_mgr_pending = 0;
+    PPOS_PREEMPT_ENABLE;
+}
+
+// Avisa o gerente de que ha requisicao nova (fora do tratador de sinal)
+static void disk_mgr_wakeup(void) {
+    PPOS_PREEMPT_DISABLE;
+    disk_mgr_pending = 1;
+    disk_mgr_task.awakeTime = 0;
+    PPOS_PREEMPT_ENABLE;
 }
 
 /* ============================================================
@@ -221,7 +700,7 @@ static void disk_signal_handler(int signum) {
  */
 
 static diskrequest_t *create_disk_request(int op, int block, void *buffer, task_t *task) {
-    diskrequest_t *request = (diskrequest_t *) malloc(sizeof(diskrequest_t));
+    diskrequest_t *request = disk_request_alloc();
     if (!request) {
         perror("Erro ao alocar memória para requisição de disco");
         exit(EXIT_FAILURE);
@@ -231,150 +710,1107 @@ static diskrequest_t *create_disk_request(int op, int block, void *buffer, task_
     request->op = op;
     request->launch_time = systime();
     request->block = block;
+    request->status = DISK_REQ_QUEUED;
+    request->waitQueue = NULL;
+    request->cache_buf = NULL;
+    request->blockNext = NULL;
+    request->blockPrev = NULL;
     request->next = NULL;
     request->prev = NULL;
     return request;
 }
 
 /* ============================================================
- * Funções Auxiliares para Manipulação de Filas
+ * Slab de Requisicoes de Disco
    ============================================================
  */
 
-// Adiciona uma requisição no final da fila de tarefas do disco 
-static void append_disk_task(diskrequest_t *request) {
-    if (disk_task_queue == NULL) {
-        disk_task_queue = request;
-    } else {
-        diskrequest_t *curr = disk_task_queue;
-        while (curr->next != NULL)
-            curr = curr->next;
-        curr->next = request;
-        request->prev = curr;
+// acrescenta DISK_REQ_SLAB_CHUNK requisicoes livres ao slab
+static int disk_request_slab_grow(void) {
+    diskrequest_t *chunk = (diskrequest_t *) malloc(DISK_REQ_SLAB_CHUNK * sizeof(diskrequest_t));
+    if (!chunk)
+        return -1;
+    for (int i = 0; i < DISK_REQ_SLAB_CHUNK; i++) {
+        chunk[i].next = disk_req_free;
+        disk_req_free = &chunk[i];
     }
+    disk.req_capacity += DISK_REQ_SLAB_CHUNK;
+    disk.req_grows++;
+    return 0;
 }
 
-// Adiciona uma tarefa na fila de tarefas suspensas 
-static void add_task_to_suspended_queue(task_t *task) {
-    if (disk_suspended_queue == NULL) {
-        disk_suspended_queue = task;
-    } else {
-        task_t *curr = disk_suspended_queue;
-        while (curr->next != NULL)
-            curr = curr->next;
-        curr->next = task;
-        task->prev = curr;
+// retira uma requisicao livre do slab, em O(1)
+static diskrequest_t *disk_request_alloc(void) {
+    diskrequest_t *request;
+
+    PPOS_PREEMPT_DISABLE;
+    if (disk_req_free == NULL && disk_request_slab_grow() < 0) {
+        PPOS_PREEMPT_ENABLE;
+        return NULL;
     }
+    request = disk_req_free;
+    disk_req_free = request->next;
+    disk.req_in_use++;
+    if (disk.req_in_use > disk.req_high_water)
+        disk.req_high_water = disk.req_in_use;
+    PPOS_PREEMPT_ENABLE;
+    return request;
 }
 
-// Adiciona uma tarefa na fila de prontos (readyQueue) 
-static void add_task_to_ready_queue(task_t *task) {
-    if (readyQueue == NULL) {
-        readyQueue = task;
-        readyQueue->next = readyQueue;
-        readyQueue->prev = readyQueue;
-    } else {
-        task_t *last = readyQueue->prev;
-        last->next = task;
-        task->prev = last;
-        task->next = readyQueue;
-        readyQueue->prev = task;
+// devolve a requisicao ao slab, em O(1)
+static void disk_request_free(diskrequest_t *request) {
+    PPOS_PREEMPT_DISABLE;
+    request->next = disk_req_free;
+    disk_req_free = request;
+    disk.req_in_use--;
+    PPOS_PREEMPT_ENABLE;
+}
+
+/* ============================================================
+ * Fila e Índice de Requisições Pendentes
+   ============================================================
+ */
+
+// Aloca o indice por bloco para um disco de num_blocks blocos
+static int disk_index_init(int num_blocks) {
+    if (disk_block_index != NULL)
+        return 0;
+    disk_block_index = (diskbucket_t *) calloc(num_blocks, sizeof(diskbucket_t));
+    if (!disk_block_index)
+        return -1;
+    return disk_map_init(&disk_block_map, num_blocks);
+}
+
+// Menor bloco pendente >= block, ou -1 se nao houver
+static int disk_index_next(int block) {
+    return disk_map_next(&disk_block_map, block);
+}
+
+// Maior bloco pendente <= block, ou -1 se nao houver
+static int disk_index_prev(int block) {
+    return disk_map_prev(&disk_block_map, block);
+}
+
+// Insere a requisicao na fila de pendentes e no indice do seu bloco
+static void enqueue_disk_request(diskrequest_t *request) {
+    diskbucket_t *bucket = &disk_block_index[request->block];
+
+    request->seq = disk_req_seq++;
+    diskqueue_append(&disk_task_queue[DISK_REQ_TYPE(request->op)], request);
+    request->blockNext = NULL;
+    request->blockPrev = bucket->last;
+    if (bucket->last)
+        bucket->last->blockNext = request;
+    else {
+        bucket->first = request;
+        disk_map_set(&disk_block_map, request->block);
+    }
+    bucket->last = request;
+}
+
+// Retira a requisicao da fila de pendentes e do indice do seu bloco
+static diskrequest_t *dequeue_disk_request(diskrequest_t *request) {
+    diskbucket_t *bucket = &disk_block_index[request->block];
+
+    if (request->blockPrev)
+        request->blockPrev->blockNext = request->blockNext;
+    else
+        bucket->first = request->blockNext;
+    if (request->blockNext)
+        request->blockNext->blockPrev = request->blockPrev;
+    else
+        bucket->last = request->blockPrev;
+    request->blockNext = request->blockPrev = NULL;
+    if (bucket->first == NULL)
+        disk_map_clear(&disk_block_map, request->block);
+    return diskqueue_remove(&disk_task_queue[DISK_REQ_TYPE(request->op)], request);
+}
+
+// Numero de requisicoes pendentes
+static int disk_pending(void) {
+    return diskqueue_size(&disk_task_queue[DISK_REQ_READ]) +
+           diskqueue_size(&disk_task_queue[DISK_REQ_WRITE]);
+}
+
+/* ============================================================
+ * Conjuntos de Blocos (Bitmap Hierarquico)
+   ============================================================
+ */
+
+// Aloca um conjunto vazio para um disco de num_blocks blocos
+static int disk_map_init(diskmap_t *map, int num_blocks) {
+    int words = num_blocks;
+
+    map->levels = 0;
+    do {
+        words = (words + DISK_MAP_BITS - 1) / DISK_MAP_BITS;
+        if (map->levels == DISK_MAP_MAX_LEVELS)
+            return -1;
+        map->words[map->levels] = (unsigned long *) calloc(words, sizeof(unsigned long));
+        if (!map->words[map->levels])
+            return -1;
+        map->size[map->levels++] = words;
+    } while (words > 1);
+    return 0;
+}
+
+// Marca o bloco em todos os niveis que ainda nao o indicam
+static void disk_map_set(diskmap_t *map, int block) {
+    long pos = block;
+    for (int level = 0; level < map->levels; level++) {
+        unsigned long *word = &map->words[level][pos / DISK_MAP_BITS];
+        int was_empty = (*word == 0);
+        *word |= 1UL << (pos % DISK_MAP_BITS);
+        if (!was_empty)
+            break;
+        pos /= DISK_MAP_BITS;
+    }
+}
+
+// Desmarca o bloco, subindo enquanto as palavras ficarem vazias
+static void disk_map_clear(diskmap_t *map, int block) {
+    long pos = block;
+    for (int level = 0; level < map->levels; level++) {
+        unsigned long *word = &map->words[level][pos / DISK_MAP_BITS];
+        *word &= ~(1UL << (pos % DISK_MAP_BITS));
+        if (*word != 0)
+            break;
+        pos /= DISK_MAP_BITS;
+    }
+}
+
+// Menor bloco marcado >= block, ou -1 se nao houver
+static int disk_map_next(diskmap_t *map, int block) {
+    long pos = block < 0 ? 0 : block;
+    int level = 0;
+
+    if (pos >= disk.num_blocks)
+        return -1;
+    // sobe ate achar uma palavra com bit marcado a partir de pos
+    for (; level < map->levels; level++) {
+        long w = pos / DISK_MAP_BITS;
+        if (w >= map->size[level])
+            return -1;
+        unsigned long bits = map->words[level][w] & (~0UL << (pos % DISK_MAP_BITS));
+        if (bits) {
+            pos = w * DISK_MAP_BITS + __builtin_ctzl(bits);
+            break;
+        }
+        pos = w + 1;
+    }
+    if (level == map->levels)
+        return -1;
+    // desce pelo primeiro bit marcado de cada palavra
+    while (level-- > 0)
+        pos = pos * DISK_MAP_BITS + __builtin_ctzl(map->words[level][pos]);
+    return pos;
+}
+
+// Maior bloco marcado <= block, ou -1 se nao houver
+static int disk_map_prev(diskmap_t *map, int block) {
+    long pos = block >= disk.num_blocks ? disk.num_blocks - 1 : block;
+    int level = 0;
+
+    // sobe ate achar uma palavra com bit marcado ate pos
+    for (; level < map->levels; level++) {
+        if (pos < 0)
+            return -1;
+        long w = pos / DISK_MAP_BITS;
+        int bit = pos % DISK_MAP_BITS;
+        unsigned long mask = (bit == DISK_MAP_BITS - 1) ? ~0UL : (1UL << (bit + 1)) - 1;
+        unsigned long bits = map->words[level][w] & mask;
+        if (bits) {
+            pos = w * DISK_MAP_BITS + DISK_MAP_BITS - 1 - __builtin_clzl(bits);
+            break;
+        }
+        pos = w - 1;
+    }
+    if (level == map->levels)
+        return -1;
+    // desce pelo ultimo bit marcado de cada palavra
+    while (level-- > 0)
+        pos = pos * DISK_MAP_BITS + DISK_MAP_BITS - 1 - __builtin_clzl(map->words[level][pos]);
+    return pos;
+}
+
+/* ============================================================
+ * Estatísticas de Espera na Fila
+   ============================================================
+ */
+
+static int disk_wait_bucket(int wait) {
+    int exp;
+
+    if (wait < DISK_WAIT_SUB)
+        return wait < 0 ? 0 : wait;
+    exp = 31 - __builtin_clz(wait);  // >= 3
+    return (exp - 2) * DISK_WAIT_SUB + ((wait >> (exp - 3)) & (DISK_WAIT_SUB - 1));
+}
+
+// maior espera que cai na faixa bucket
+static int disk_wait_bucket_max(int bucket) {
+    int exp, sub;
+
+    if (bucket < DISK_WAIT_SUB)
+        return bucket;
+    exp = bucket / DISK_WAIT_SUB + 2;
+    sub = bucket % DISK_WAIT_SUB;
+    return ((DISK_WAIT_SUB + sub + 1) << (exp - 3)) - 1;
+}
+
+static void disk_wait_record(int type, int wait) {
+    disk_wait_hist[type][disk_wait_bucket(wait)]++;
+    disk.wait_count[type]++;
+    if (wait > disk.wait_max[type])
+        disk.wait_max[type] = wait;
+}
+
+// espera abaixo da qual estao permille/1000 das requisicoes do tipo,
+// limitada a maior espera observada
+static int disk_wait_percentile(int type, int permille) {
+    long target = ((long) disk.wait_count[type] * permille + 999) / 1000;
+    long seen = 0;
+
+    if (disk.wait_count[type] == 0)
+        return 0;
+    for (int bucket = 0; bucket < DISK_WAIT_BUCKETS; bucket++) {
+        seen += disk_wait_hist[type][bucket];
+        if (seen >= target) {
+            int wait = disk_wait_bucket_max(bucket);
+            return wait < disk.wait_max[type] ? wait : disk.wait_max[type];
+        }
+    }
+    return disk.wait_max[type];
+}
+
+/* ============================================================
+ * Conclusão de Requisições
+   ============================================================
+ */
+
+// Marca a requisicao como concluida (DISK_REQ_DONE) ou recusada pelo disco
+// (DISK_REQ_FAILED) e devolve a tarefa solicitante a fila de prontas pelo
+// nucleo (task_resume); a tarefa libera a requisicao. Uma leitura
+// antecipada nao tem solicitante: o gerente preenche o buffer
+static void complete_disk_request(diskrequest_t *request, int status) {
+    request->status = status;
+    if (request->cache_buf != NULL) {
+        disk_readahead_done(request);
+        return;
     }
+    PPOS_PREEMPT_DISABLE;
+    while (request->waitQueue != NULL)
+        task_resume(request->waitQueue);
+    PPOS_PREEMPT_ENABLE;
 }
 
-// Remove uma tarefa específica da fila de suspensas 
-static task_t *remove_task_from_suspended_queue(task_t *task) {
-    if (!task)
+/* ============================================================
+ * Cache de Blocos
+   ============================================================
+ */
+
+// Aloca os buffers e a tabela hash (chamada com preempcao desabilitada)
+static int disk_cache_init(void) {
+    int slots = 1;
+
+    disk.cache_capacity = 0;
+    if (disk_cache != NULL || disk_cache_size == 0)
+        return 0;
+    if (disk_cache_size > disk.num_blocks)
+        disk_cache_size = disk.num_blocks;
+    while (slots < 2 * disk_cache_size)
+        slots <<= 1;
+
+    disk_cache = (diskbuf_t *) calloc(disk_cache_size, sizeof(diskbuf_t));
+    disk_cache_hash = (diskbuf_t **) calloc(slots, sizeof(diskbuf_t *));
+    unsigned char *data = (unsigned char *) malloc((size_t) disk_cache_size * disk.block_size);
+    if (!disk_cache || !disk_cache_hash || !data) {
+        free(disk_cache);
+        free(disk_cache_hash);
+        free(data);
+        disk_cache = NULL;
+        disk_cache_hash = NULL;
+        return -1;
+    }
+    for (int i = 0; i < disk_cache_size; i++) {
+        disk_cache[i].block = -1;
+        disk_cache[i].data = data + (size_t) i * disk.block_size;
+    }
+    disk_cache_mask = slots - 1;
+    disk_cache_hand = 0;
+    disk.cache_capacity = disk_cache_size;
+    return 0;
+}
+
+// Buffer que guarda o bloco, ou NULL
+static diskbuf_t *disk_cache_lookup(int block) {
+    diskbuf_t *buf = disk_cache_hash[block & disk_cache_mask];
+
+    while (buf != NULL && buf->block != block)
+        buf = buf->hashNext;
+    return buf;
+}
+
+static void disk_cache_insert(diskbuf_t *buf, int block) {
+    diskbuf_t **slot = &disk_cache_hash[block & disk_cache_mask];
+
+    buf->block = block;
+    buf->valid = 0;
+    buf->ref = 1;
+    buf->ahead = 0;
+    buf->hashNext = *slot;
+    *slot = buf;
+}
+
+// Retira o buffer da tabela hash, deixando-o livre
+static void disk_cache_drop(diskbuf_t *buf) {
+    diskbuf_t **link = &disk_cache_hash[buf->block & disk_cache_mask];
+
+    while (*link != buf)
+        link = &(*link)->hashNext;
+    *link = buf->hashNext;
+    buf->hashNext = NULL;
+    buf->block = -1;
+    buf->valid = 0;
+    buf->ahead = 0;
+}
+
+// CLOCK: o primeiro buffer nao referenciado a partir do ponteiro, zerando as
+// referencias pelo caminho; buffers em leitura, sujos, em gravacao e fixados
+// sao pulados. Com spare (leitura antecipada), faz uma so volta sem zerar
+// referencias, para que blocos especulativos nao envelhecam os usados.
+// Retorna o buffer ja fora da tabela, ou NULL se nenhum puder ser substituido
+static diskbuf_t *disk_cache_victim(int spare) {
+    int turns = spare ? disk.cache_capacity : 2 * disk.cache_capacity;
+
+    for (int i = 0; i < turns; i++) {
+        diskbuf_t *buf = &disk_cache[disk_cache_hand];
+        disk_cache_hand = (disk_cache_hand + 1) % disk.cache_capacity;
+        if (buf->busy || buf->dirty || buf->writing || buf->pins)
+            continue;
+        if (buf->ref) {
+            if (!spare)
+                buf->ref = 0;
+            continue;
+        }
+        if (buf->block >= 0) {
+            if (buf->valid)
+                disk.cache_evictions++;
+            // antecipado sem uso: a janela da sua sequencia era grande demais
+            if (buf->ahead) {
+                diskstream_t *stream = &disk_ra_stream[buf->stream];
+                stream->window /= 2;
+                if (stream->window < DISK_READAHEAD_MIN)
+                    stream->window = DISK_READAHEAD_MIN;
+                disk.ra_wasted++;
+            }
+            disk_cache_drop(buf);
+        }
+        return buf;
+    }
+    return NULL;
+}
+
+// Aguarda o fim da leitura ou gravacao do buffer (chamada com preempcao
+// desabilitada; retorna com ela desabilitada)
+static void disk_cache_wait(diskbuf_t *buf) {
+    task_suspend(taskExec, &(buf->waitQueue));
+    PPOS_PREEMPT_ENABLE;
+    task_yield();
+    PPOS_PREEMPT_DISABLE;
+}
+
+// Acha o bloco no cache, lendo-o do disco para um buffer escolhido pelo
+// CLOCK em uma falta; quem procura um bloco em leitura ou fixado para
+// escrita aguarda. Chamada com preempcao desabilitada; retorna com ela
+// desabilitada o buffer valido, ou NULL se nao houver buffer livre (ou,
+// com DISK_GET_NOWAIT, se o bloco nao estiver pronto no cache). *extend
+// indica que a leitura antecipada da sequencia deve prosseguir: apos uma
+// falta ou um acerto em bloco que ela mesma antecipou
+static diskbuf_t *disk_cache_fetch(int block, int flags, diskstream_t *stream, int *extend) {
+    diskbuf_t *buf;
+    int result, start = systime();
+
+    *extend = 0;
+    while ((buf = disk_cache_lookup(block)) != NULL && (buf->busy || buf->wpin)) {
+        if (flags & DISK_GET_NOWAIT)
+            return NULL;
+        disk_cache_wait(buf);
+    }
+    if (buf != NULL && buf->valid) {
+        buf->ref = 1;
+        disk.cache_hits++;
+        // acerto em bloco antecipado: poupou o atendimento da leitura
+        // antecipada, menos a espera que ainda restava. Se quem o antecipou
+        // foi a propria sequencia, a janela cresce; blocos ja no cache por
+        // outros motivos nao indicam que os seguintes faltam
+        if (buf->ahead) {
+            int waited = systime() - start;
+            buf->ahead = 0;
+            disk.ra_hits++;
+            if (buf->ahead_latency > waited)
+                disk.ra_saved += buf->ahead_latency - waited;
+            if (stream != NULL && stream == &disk_ra_stream[buf->stream]) {
+                if (stream->window < disk_readahead_window())
+                    stream->window++;
+                *extend = 1;
+            }
+        }
+        return buf;
+    }
+    if (flags & DISK_GET_NOWAIT)
         return NULL;
+    disk.cache_misses++;
+    if (buf == NULL && (buf = disk_cache_victim(0)) != NULL)
+        disk_cache_insert(buf, block);
+    if (buf == NULL)
+        return NULL;
+    buf->busy = 1;
+    PPOS_PREEMPT_ENABLE;
+
+    result = disk_block_operation(DISK_CMD_READ, block, buf->data);
 
-    task_t *next = task->next;
-    task_t *prev = task->prev;
+    PPOS_PREEMPT_DISABLE;
+    buf->busy = 0;
+    if (result == 0)
+        buf->valid = 1;
+    else
+        disk_cache_drop(buf);
+    while (buf->waitQueue != NULL)
+        task_resume(buf->waitQueue);
+    if (result < 0)
+        return NULL;
+    *extend = (stream != NULL);
+    return buf;
+}
 
-    if (task == disk_suspended_queue)
-        disk_suspended_queue = next;
-    if (prev)
-        prev->next = next;
-    if (next)
-        next->prev = prev;
+// Leitura pelo cache: um acerto e copiado sem criar requisicao nem passar
+// pelo gerente; sem buffer livre, le direto, sem passar pelo cache
+static int disk_cache_read(int block, void *buffer) {
+    diskstream_t *stream;
+    diskbuf_t *buf;
+    int extend;
 
-    task->next = task->prev = NULL;
-    return task;
+    PPOS_PREEMPT_DISABLE;
+    stream = disk_stream_note(block);
+    buf = disk_cache_fetch(block, 0, stream, &extend);
+    if (buf == NULL) {
+        PPOS_PREEMPT_ENABLE;
+        return disk_block_operation(DISK_CMD_READ, block, buffer);
+    }
+    memcpy(buffer, buf->data, disk.block_size);
+    PPOS_PREEMPT_ENABLE;
+    if (extend)
+        disk_readahead(stream, block);
+    return 0;
+}
+
+// Fixa o bloco para leitura, devolvendo o buffer do cache (ou NULL)
+static diskbuf_t *disk_cache_get(int block, int flags) {
+    diskstream_t *stream;
+    diskbuf_t *buf;
+    int extend;
+
+    PPOS_PREEMPT_DISABLE;
+    stream = disk_stream_note(block);
+    buf = disk_cache_fetch(block, flags, stream, &extend);
+    if (buf != NULL) {
+        buf->pins++;
+        disk.cache_pinned++;
+        disk.cache_gets++;
+    }
+    PPOS_PREEMPT_ENABLE;
+    if (extend)
+        disk_readahead(stream, block);
+    return buf;
 }
 
-// Remove uma requisição específica da fila de tarefas do disco 
-static diskrequest_t *remove_disk_request(diskrequest_t *request) {
-    if (!request)
+// Fixa o bloco para escrita, com exclusividade: aguarda os demais fixadores
+// e, se o bloco for novo no limite de sujos, a descarga. Enquanto fixado,
+// o buffer sai da contagem de sujos, pois o conteudo so e considerado
+// escrito em disk_block_put
+static diskbuf_t *disk_cache_get_write(int block, int flags) {
+    diskbuf_t *buf;
+    int throttled = 0, extend;
+
+    PPOS_PREEMPT_DISABLE;
+    for (;;) {
+        buf = disk_cache_lookup(block);
+        if (buf != NULL && (buf->busy || buf->writing || buf->pins)) {
+            if (flags & DISK_GET_NOWAIT) {
+                buf = NULL;
+                break;
+            }
+            disk_cache_wait(buf);
+            continue;
+        }
+        if (disk.cache_write_back && !(buf != NULL && buf->dirty) && disk_dirty_full()) {
+            if (flags & DISK_GET_NOWAIT) {
+                buf = NULL;
+                break;
+            }
+            disk_dirty_throttle(&throttled);
+            continue;
+        }
+        if (buf != NULL && buf->valid)
+            break;
+        // o bloco sera todo reescrito: basta um buffer, sem ler o disco
+        if (flags & DISK_GET_OVERWRITE) {
+            if (buf == NULL && (buf = disk_cache_victim(0)) != NULL)
+                disk_cache_insert(buf, block);
+            if (buf != NULL)
+                buf->valid = 1;
+            break;
+        }
+        // le o bloco e reavalia, pois outras tarefas podem te-lo fixado
+        if ((flags & DISK_GET_NOWAIT) || disk_cache_fetch(block, 0, NULL, &extend) == NULL) {
+            buf = NULL;
+            break;
+        }
+    }
+    if (buf == NULL) {
+        PPOS_PREEMPT_ENABLE;
         return NULL;
+    }
 
-    diskrequest_t *next = request->next;
-    diskrequest_t *prev = request->prev;
+    buf->pins = 1;
+    buf->wpin = 1;
+    buf->ref = 1;
+    buf->ahead = 0;
+    if (buf->dirty) {
+        buf->dirty = 0;
+        disk_map_clear(&disk_dirty_map, block);
+        disk.cache_dirty--;
+    }
+    disk.cache_pinned++;
+    disk.cache_gets++;
+    PPOS_PREEMPT_ENABLE;
+    return buf;
+}
 
-    if (request == disk_task_queue)
-        disk_task_queue = next;
-    if (prev)
-        prev->next = next;
-    if (next)
-        next->prev = prev;
+// Solta o buffer fixado; um buffer fixado para escrita fica sujo (escrita
+// adiada) ou e gravado antes de ser solto (escrita direta)
+static int disk_cache_put(diskbuf_t *buf) {
+    int result = 0;
 
-    request->next = request->prev = NULL;
-    return request;
+    PPOS_PREEMPT_DISABLE;
+    if (buf->pins == 0) {
+        PPOS_PREEMPT_ENABLE;
+        return -1;
+    }
+    if (buf->wpin) {
+        if (disk.cache_write_back) {
+            disk_cache_mark_dirty(buf);
+        } else {
+            PPOS_PREEMPT_ENABLE;
+            result = disk_block_operation(DISK_CMD_WRITE, buf->block, buf->data);
+            PPOS_PREEMPT_DISABLE;
+        }
+        buf->wpin = 0;
+    }
+    buf->pins--;
+    disk.cache_pinned--;
+    // a gravacao falhou: o cache nao pode ficar diferente do disco
+    if (result < 0)
+        disk_cache_drop(buf);
+    while (buf->pins == 0 && buf->waitQueue != NULL)
+        task_resume(buf->waitQueue);
+    PPOS_PREEMPT_ENABLE;
+    return result;
+}
+
+// Escrita direta (write-through): atualiza (ou cria) a copia do bloco no
+// cache e a grava no disco. Ate a gravacao terminar o buffer fica marcado
+// em gravacao: nao e substituido, e uma leitura do disco reordenada antes
+// da escrita nao o recarrega com o conteudo antigo; se ela falhar, o buffer
+// sai do cache. Sem buffer livre, grava direto, sem passar pelo cache
+static int disk_cache_write(int block, void *buffer) {
+    diskbuf_t *buf;
+    int result;
+
+    PPOS_PREEMPT_DISABLE;
+    while ((buf = disk_cache_lookup(block)) != NULL && (buf->busy || buf->writing || buf->pins))
+        disk_cache_wait(buf);
+    if (buf == NULL && (buf = disk_cache_victim(0)) != NULL)
+        disk_cache_insert(buf, block);
+    if (buf == NULL) {
+        PPOS_PREEMPT_ENABLE;
+        return disk_block_operation(DISK_CMD_WRITE, block, buffer);
+    }
+    memcpy(buf->data, buffer, disk.block_size);
+    buf->valid = 1;
+    buf->ref = 1;
+    buf->ahead = 0;
+    buf->writing = 1;
+    PPOS_PREEMPT_ENABLE;
+
+    result = disk_block_operation(DISK_CMD_WRITE, block, buffer);
+
+    PPOS_PREEMPT_DISABLE;
+    buf->writing = 0;
+    if (result < 0)
+        disk_cache_drop(buf);
+    while (buf->waitQueue != NULL)
+        task_resume(buf->waitQueue);
+    PPOS_PREEMPT_ENABLE;
+    return result;
+}
+
+// Escrita adiada: copia o bloco para o cache e o marca sujo, sem esperar o
+// disco. Reescrever um bloco ainda sujo nao gera nova gravacao; um bloco
+// novo aguarda enquanto os sujos estiverem no limite. Sem buffer livre
+// (todos em leitura, sujos ou fixados), a escrita vai direto ao disco
+static int disk_cache_write_back(int block, void *buffer) {
+    diskbuf_t *buf;
+    int throttled = 0;
+
+    PPOS_PREEMPT_DISABLE;
+    for (;;) {
+        // o conteudo de um buffer em gravacao ou fixado nao pode mudar
+        buf = disk_cache_lookup(block);
+        if (buf != NULL && (buf->busy || buf->writing || buf->pins)) {
+            disk_cache_wait(buf);
+            continue;
+        }
+        if (buf != NULL && buf->dirty)
+            break;
+        if (disk_dirty_full()) {
+            disk_dirty_throttle(&throttled);
+            continue;
+        }
+        if (buf == NULL && (buf = disk_cache_victim(0)) != NULL)
+            disk_cache_insert(buf, block);
+        break;
+    }
+    if (buf == NULL) {
+        PPOS_PREEMPT_ENABLE;
+        return disk_block_operation(DISK_CMD_WRITE, block, buffer);
+    }
+
+    memcpy(buf->data, buffer, disk.block_size);
+    buf->valid = 1;
+    buf->ref = 1;
+    buf->ahead = 0;
+    disk_cache_mark_dirty(buf);
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
+// Marca o buffer sujo (chamada com preempcao desabilitada); o primeiro sujo
+// arma o despertar periodico da descarga, e o limite BACKGROUND a acorda
+// de imediato
+static void disk_cache_mark_dirty(diskbuf_t *buf) {
+    if (buf->dirty) {
+        disk.cache_absorbed++;
+        return;
+    }
+    buf->dirty = 1;
+    disk_map_set(&disk_dirty_map, buf->block);
+    if (++disk.cache_dirty >= disk_dirty_blocks(disk_dirty_ratio[0]))
+        disk_flush_task.awakeTime = 0;
+    else if (disk.cache_dirty == 1)
+        disk_flush_task.awakeTime = systime() + DISK_FLUSH_INTERVAL;
+}
+
+// Os sujos chegaram ao limite LIMIT?
+static int disk_dirty_full(void) {
+    return disk.cache_dirty >= disk_dirty_blocks(disk_dirty_ratio[1]);
+}
+
+// Aguarda a descarga liberar buffers (chamada com preempcao desabilitada;
+// retorna com ela desabilitada); conta uma vez cada escrita retida
+static void disk_dirty_throttle(int *throttled) {
+    if (!(*throttled)++)
+        disk.cache_throttled++;
+    disk_flush_task.awakeTime = 0;
+    task_suspend(taskExec, &disk_throttle_queue);
+    PPOS_PREEMPT_ENABLE;
+    task_yield();
+    PPOS_PREEMPT_DISABLE;
+}
+
+// Grava o buffer no disco se ele estiver sujo, aguardando antes a gravacao
+// em andamento (chamada com preempcao desabilitada; retorna com ela
+// desabilitada). Durante a gravacao o buffer fica fixo: escritores
+// aguardam, e leitores continuam sendo atendidos por ele
+static int disk_cache_flush(diskbuf_t *buf) {
+    int block = buf->block, result;
+
+    while (buf->writing)
+        disk_cache_wait(buf);
+    // gravado por outra tarefa enquanto aguardava (e talvez ja substituido)
+    if (buf->block != block || !buf->dirty)
+        return 0;
+
+    buf->writing = 1;
+    PPOS_PREEMPT_ENABLE;
+    result = disk_block_operation(DISK_CMD_WRITE, block, buf->data);
+    PPOS_PREEMPT_DISABLE;
+    buf->writing = 0;
+    if (result == 0) {
+        buf->dirty = 0;
+        disk_map_clear(&disk_dirty_map, block);
+        disk.cache_dirty--;
+        disk.cache_flushes++;
+    }
+    while (buf->waitQueue != NULL)
+        task_resume(buf->waitQueue);
+    // sem sucesso os sujos nao diminuiram: acordar as escritas retidas so as
+    // faria acordar a descarga de novo, anulando o recuo apos o erro
+    while (result == 0 && disk_throttle_queue != NULL)
+        task_resume(disk_throttle_queue);
+    return result;
+}
+
+// Limite de buffers sujos correspondente a ratio % do cache (ao menos 1)
+static int disk_dirty_blocks(int ratio) {
+    int blocks = disk.cache_capacity * ratio / 100;
+    return blocks > 0 ? blocks : 1;
 }
 
 /* ============================================================
- * Escalonadores de Requisições para o Disco
+ * Leitura Antecipada
    ============================================================
  */
-static diskrequest_t* fcfs_scheduler(diskrequest_t* queue) {
-    // FCFS scheduler
-   if ( queue != NULL ) {
-       PPOS_PREEMPT_DISABLE
-       diskrequest_t* request = queue;
-       PPOS_PREEMPT_ENABLE
-       return request;
-   }
-   return NULL;
-}
-
-static diskrequest_t *sstf_scheduler(diskrequest_t *queue) {
-    if (queue == NULL)
+
+// Sequencia da tarefa corrente, tomando a usada ha mais tempo se ela nao
+// tiver uma (chamada com preempcao desabilitada)
+static diskstream_t *disk_stream_find(void) {
+    diskstream_t *stream = NULL, *lru = &disk_ra_stream[0];
+
+    for (int i = 0; i < DISK_RA_STREAMS && stream == NULL; i++) {
+        if (disk_ra_stream[i].task == taskExec)
+            stream = &disk_ra_stream[i];
+        else if (disk_ra_stream[i].used < lru->used)
+            lru = &disk_ra_stream[i];
+    }
+    if (stream == NULL) {
+        stream = lru;
+        stream->task = taskExec;
+        stream->next = -1;
+        stream->run = 0;
+        stream->window = DISK_READAHEAD_MIN;
+        stream->frontier = -1;
+    }
+    stream->used = ++disk_ra_clock;
+    return stream;
+}
+
+// Registra a leitura de block na sequencia da tarefa corrente, que e
+// prolongada se block segue a ultima leitura; NULL se a leitura antecipada
+// estiver desligada (chamada com preempcao desabilitada)
+static diskstream_t *disk_stream_note(int block) {
+    diskstream_t *stream;
+
+    if (disk_readahead_window() == 0)
         return NULL;
-    // SSTF scheduler
-    diskrequest_t *selected = queue;
-    int min_distance = abs(selected->block - disk.head_position);
-
-    for (diskrequest_t *curr = queue->next; curr != NULL; curr = curr->next) {
-        int distance = abs(curr->block - disk.head_position);
-        if (distance < min_distance) {
-            selected = curr;
-            min_distance = distance;
+    stream = disk_stream_find();
+    if (block == stream->next) {
+        stream->run++;
+    } else {
+        stream->run = 1;
+        stream->frontier = block;
+    }
+    stream->next = block + 1;
+    return stream;
+}
+
+// Janela maxima em uso: a configurada, limitada a metade do cache
+static int disk_readahead_window(void) {
+    int half = disk.cache_capacity / 2;
+    return disk_ra_max < half ? disk_ra_max : half;
+}
+
+// Antecipa os blocos ainda fora do cache ate window alem de block, no maximo
+// DISK_RA_BATCH por leitura: os buffers sao reservados com preempcao
+// desabilitada e as requisicoes entram juntas na fila do gerente
+#define DISK_RA_BATCH 16
+static void disk_readahead(diskstream_t *stream, int block) {
+    diskbuf_t *batch[DISK_RA_BATCH];
+    diskrequest_t *request[DISK_RA_BATCH];
+    int count = 0, last, i;
+
+    PPOS_PREEMPT_DISABLE;
+    // a sequencia pode ter sido tomada por outra tarefa durante a leitura
+    if (stream->task != taskExec || stream->run < DISK_READAHEAD_TRIGGER) {
+        PPOS_PREEMPT_ENABLE;
+        return;
+    }
+    if (stream->window > disk_readahead_window())
+        stream->window = disk_readahead_window();
+    last = block + stream->window;
+    if (last >= disk.num_blocks)
+        last = disk.num_blocks - 1;
+    if (stream->frontier < block)
+        stream->frontier = block;
+    while (stream->frontier < last && count < DISK_RA_BATCH) {
+        int next = stream->frontier + 1;
+        diskbuf_t *buf = disk_cache_lookup(next);
+        if (buf == NULL) {
+            if ((buf = disk_cache_victim(1)) == NULL)
+                break;
+            disk_cache_insert(buf, next);
+            buf->ref = 0;   // se nao for usado, e dos primeiros a sair
+            buf->busy = 1;
+            buf->ahead = 1;
+            buf->stream = stream - disk_ra_stream;
+            batch[count++] = buf;
         }
+        stream->frontier = next;
     }
-    return selected;
+    disk.ra_issued += count;
+    PPOS_PREEMPT_ENABLE;
+    if (count == 0)
+        return;
+
+    for (i = 0; i < count; i++) {
+        request[i] = create_disk_request(DISK_CMD_READ, batch[i]->block, batch[i]->data, NULL);
+        request[i]->cache_buf = batch[i];
+    }
+    sem_down(&disk_task_sem);
+    for (i = 0; i < count; i++)
+        enqueue_disk_request(request[i]);
+    sem_up(&disk_task_sem);
+    disk_mgr_wakeup();
 }
 
-static diskrequest_t *cscan_scheduler(diskrequest_t *queue) {
-    if (queue == NULL)
-        return NULL;
-    //cscan scheduler
-    diskrequest_t *selected = NULL;
-    int min_distance = disk.num_blocks + 100; // Valor grande arbitrário
-
-    for (diskrequest_t *curr = queue; curr != NULL; curr = curr->next) {
-        if (curr->block > disk.head_position && (curr->block - disk.head_position) < min_distance) {
-            selected = curr;
-            min_distance = curr->block - disk.head_position;
+// Conclusao de uma leitura antecipada, pelo gerente: o buffer fica valido,
+// os leitores que o aguardavam prosseguem e a requisicao volta ao slab
+static void disk_readahead_done(diskrequest_t *request) {
+    diskbuf_t *buf = request->cache_buf;
+
+    PPOS_PREEMPT_DISABLE;
+    buf->busy = 0;
+    // recusada: o buffer sai do cache e quem o aguardava le o bloco por conta
+    if (request->status == DISK_REQ_FAILED)
+        disk_cache_drop(buf);
+    else
+        buf->valid = 1;
+    // so o atendimento pelo disco: a espera na fila, atras das demais
+    // antecipacoes, nao seria paga por uma leitura isolada
+    buf->ahead_latency = systime() - request->start_time;
+    while (buf->waitQueue != NULL)
+        task_resume(buf->waitQueue);
+    PPOS_PREEMPT_ENABLE;
+    disk_request_free(request);
+}
+
+/* ============================================================
+ * Descarga dos Blocos Sujos
+   ============================================================
+ */
+
+// Tarefa de descarga: a cada despertar, grava todos os blocos sujos em ordem
+// crescente a partir de onde parou, voltando ao inicio do disco ao chegar
+// ao fim, como o C-LOOK
+static void disk_flusher(void *args) {
+    (void) args;
+
+    PPOS_PREEMPT_DISABLE;
+    while (1) {
+        disk_flush_wait();
+        while (disk.cache_dirty > 0) {
+            int block = disk_map_next(&disk_dirty_map, disk_flush_cursor);
+            if (block < 0)
+                block = disk_map_next(&disk_dirty_map, 0);
+            disk_flush_cursor = block + 1;
+            // gravacao recusada: o bloco segue sujo e voltaria a ser escolhido
+            // em seguida; recua e so tenta de novo apos DISK_FLUSH_INTERVAL
+            if (disk_cache_flush(disk_cache_lookup(block)) < 0) {
+                disk_flush_sleep(systime() + DISK_FLUSH_INTERVAL);
+                break;
+            }
         }
     }
+}
+
+// Estaciona a descarga na fila de tarefas dormindo: sem sujos, ate o
+// primeiro escritor armar o despertar; com sujos abaixo de BACKGROUND, por
+// DISK_FLUSH_INTERVAL. Chamada com preempcao desabilitada
+static void disk_flush_wait(void) {
+    if (disk.cache_dirty >= disk_dirty_blocks(disk_dirty_ratio[0]))
+        return;
+    disk_flush_sleep(disk.cache_dirty > 0 ? systime() + DISK_FLUSH_INTERVAL : UINT_MAX);
+}
+
+// Suspende a descarga na fila de tarefas dormindo ate awake (UINT_MAX: ate
+// ser despertada). Chamada com preempcao desabilitada
+static void disk_flush_sleep(unsigned int awake) {
+    disk_flush_task.awakeTime = awake;
+    task_suspend(taskExec, &sleepQueue);
+    PPOS_PREEMPT_ENABLE;
+    task_yield();
+    PPOS_PREEMPT_DISABLE;
+}
+
+/* ============================================================
+ * Escalonadores de Requisições para o Disco
+   ============================================================
+ */
+
+// Escolhe a proxima requisicao pela politica configurada; chamada pelo
+// gerente, com a fila protegida por disk_task_sem
+diskrequest_t *disk_scheduler() {
+    static diskrequest_t *(*const schedulers[DISK_SCHED_POLICIES])(void) = {
+        fcfs_scheduler, sstf_scheduler, scan_scheduler,
+        cscan_scheduler, look_scheduler, clook_scheduler, deadline_scheduler
+    };
+    int policy = disk_sched_policy;
+
+    disk_sched_vias = 0;
+    disk_sched_via_dir = 0;
+    if (policy == DISK_SCHED_ADAPTIVE) {
+        policy = adaptive_policy();
+        if (policy != disk.sched_active)
+            disk.sched_switches++;
+    }
+    disk.sched_active = policy;
+    return schedulers[policy]();
+}
+
+// Modo adaptativo: sem fila nao ha o que reordenar, e com acessos ja locais
+// reordenar nao reduz o deslocamento, entao mantem a ordem de chegada;
+// com poucos pedidos espalhados, SSTF; com fila profunda, C-LOOK, que
+// limita a espera de cada pedido a uma varredura
+static int adaptive_policy(void) {
+    int depth = disk_pending();
+
+    if (depth <= 1 || disk_seek_avg < disk.num_blocks / DISK_ADAPT_NEAR)
+        return DISK_SCHED_FCFS;
+    if (depth < DISK_ADAPT_DEEP)
+        return DISK_SCHED_SSTF;
+    return DISK_SCHED_CLOOK;
+}
+
+// Leva a cabeca ate block sem atender requisicao (ida a borda de SCAN e
+// C-SCAN); o deslocamento entra nas estatisticas da politica corrente
+static void disk_sched_seek(int block) {
+    int steps = abs(disk.head_position - block);
+
+    disk.total_steps += steps;
+    disk.sched_steps[disk.sched_active] += steps;
+    disk.head_position = block;
+}
+
+// Registra, na escolha, uma borda por onde a cabeca passara
+static void disk_sched_pass(int block) {
+    disk_sched_via[disk_sched_vias++] = block;
+}
+
+// Chamada pelo gerente quando o disco aceita a requisicao escolhida: leva
+// a cabeca pelas bordas registradas e adota o novo sentido; o trecho ate
+// o bloco e contado na conclusao, como nas demais politicas
+static void disk_sched_travel(void) {
+    for (int i = 0; i < disk_sched_vias; i++)
+        disk_sched_seek(disk_sched_via[i]);
+    if (disk_sched_via_dir != 0)
+        disk_sched_dir = disk_sched_via_dir;
+    disk_sched_vias = 0;
+    disk_sched_via_dir = 0;
+}
+
+// FCFS: a mais antiga entre as primeiras de cada fila
+static diskrequest_t* fcfs_scheduler(void) {
+    diskrequest_t *read = diskqueue_first(&disk_task_queue[DISK_REQ_READ]);
+    diskrequest_t *write = diskqueue_first(&disk_task_queue[DISK_REQ_WRITE]);
+
+    if (read == NULL || (write != NULL && write->seq < read->seq))
+        return write;
+    return read;
+}
+
+// SSTF: o bloco pendente mais proximo da cabeca, de um lado ou de outro
+static diskrequest_t *sstf_scheduler(void) {
+    if (disk_pending() == 0)
+        return NULL;
+    int below = disk_index_prev(disk.head_position);
+    int above = disk_index_next(disk.head_position);
+    int block = above;
+
+    if (above < 0 || (below >= 0 && disk.head_position - below < above - disk.head_position))
+        block = below;
+    return disk_block_index[block].first;
+}
+
+// Proximo bloco pendente alem da cabeca no sentido dir (o bloco sob a
+// cabeca fica para a volta, para que pedidos repetidos a ele nao retenham
+// a varredura), ou -1 se nao houver
+static int disk_sweep_next(int dir) {
+    return dir > 0 ? disk_index_next(disk.head_position + 1)
+                   : disk_index_prev(disk.head_position - 1);
+}
+
+// LOOK: o proximo bloco pendente no sentido corrente; se nao houver,
+// inverte o sentido
+static diskrequest_t *look_scheduler(void) {
+    if (disk_pending() == 0)
+        return NULL;
+    int block = disk_sweep_next(disk_sched_dir);
+
+    if (block < 0) {
+        disk_sched_dir = -disk_sched_dir;
+        block = disk_sched_dir > 0 ? disk_index_next(disk.head_position)
+                                   : disk_index_prev(disk.head_position);
+    }
+    return disk_block_index[block].first;
+}
 
-    if (selected != NULL)
-        return selected;
+// SCAN: como LOOK, mas a cabeca vai ate a borda do disco antes de inverter
+static diskrequest_t *scan_scheduler(void) {
+    if (disk_pending() == 0)
+        return NULL;
+    int block = disk_sweep_next(disk_sched_dir);
+
+    if (block < 0) {
+        int edge = disk_sched_dir > 0 ? disk.num_blocks - 1 : 0;
+        disk_sched_pass(edge);
+        disk_sched_via_dir = -disk_sched_dir;
+        block = disk_sched_via_dir > 0 ? disk_index_next(edge) : disk_index_prev(edge);
+    }
+    return disk_block_index[block].first;
+}
+
+// C-SCAN: o proximo bloco pendente alem da cabeca, subindo; se nao houver,
+// a cabeca vai ate a borda e volta ao inicio do disco
+static diskrequest_t *cscan_scheduler(void) {
+    if (disk_pending() == 0)
+        return NULL;
+    int block = disk_sweep_next(1);
+
+    if (block < 0) {
+        disk_sched_pass(disk.num_blocks - 1);
+        disk_sched_pass(0);
+        block = disk_index_next(0);
+    }
+    return disk_block_index[block].first;
+}
+
+// C-LOOK: o proximo bloco pendente alem da cabeca ou, se nao houver, o
+// primeiro bloco pendente do disco
+static diskrequest_t *clook_scheduler(void) {
+    if (disk_pending() == 0)
+        return NULL;
+    int block = disk_sweep_next(1);
+
+    if (block < 0)
+        block = disk_index_next(0);
+    return disk_block_index[block].first;
+}
 
-    /* Caso não haja requisição com bloco maior que a posição atual,
-       seleciona a requisição com o menor bloco */
-    selected = queue;
-    for (diskrequest_t *curr = queue->next; curr != NULL; curr = curr->next) {
-        if (curr->block < selected->block)
-            selected = curr;
+// Deadline: SSTF, mas a requisicao mais antiga cujo prazo venceu passa a
+// frente; entre leitura e escrita vencidas, a que chegou primeiro
+static diskrequest_t *deadline_scheduler(void) {
+    diskrequest_t *expired = NULL;
+    long now = systime();
+
+    for (int type = 0; type < DISK_REQ_TYPES; type++) {
+        diskrequest_t *oldest = diskqueue_first(&disk_task_queue[type]);
+        if (oldest != NULL && now - oldest->launch_time >= disk_deadline[type] &&
+            (expired == NULL || oldest->seq < expired->seq))
+            expired = oldest;
     }
-    return selected;
+    if (expired == NULL)
+        return sstf_scheduler();
+    disk.deadline_promotions++;
+    return expired;
 }
@@ -13,18 +13,87 @@
 // a um dispositivo de entrada/saida orientado a blocos,
 // tipicamente um disco rigido.
 
+// estados de um pedido ao disco
+#define DISK_REQ_QUEUED  0   // na fila do gerente, aguardando o disco
+#define DISK_REQ_SERVING 1   // em atendimento pelo disco
+#define DISK_REQ_DONE    2   // concluido; a tarefa solicitante pode prosseguir
+#define DISK_REQ_FAILED  3   // recusado pelo disco; a operacao retorna -1
+
+// politicas de escalonamento do disco (disk_set_scheduler ou variavel de
+// ambiente PPOS_DISK_SCHED, com os nomes de disk_sched_name)
+#define DISK_SCHED_FCFS     0   // ordem de chegada
+#define DISK_SCHED_SSTF     1   // menor deslocamento da cabeca
+#define DISK_SCHED_SCAN     2   // elevador, indo ate a borda do disco
+#define DISK_SCHED_CSCAN    3   // elevador em um so sentido, indo ate a borda
+#define DISK_SCHED_LOOK     4   // elevador, invertendo no ultimo pedido
+#define DISK_SCHED_CLOOK    5   // elevador em um so sentido, sem ir ate a borda
+#define DISK_SCHED_DEADLINE 6   // SSTF, mas atende antes os pedidos com prazo vencido
+#define DISK_SCHED_POLICIES 7   // numero de politicas concretas
+#define DISK_SCHED_ADAPTIVE 7   // escolhe entre as acima pela carga observada
+
+// tipos de requisicao, para filas e estatisticas separadas
+#define DISK_REQ_READ  0
+#define DISK_REQ_WRITE 1
+#define DISK_REQ_TYPES 2
+
+// prazos padrao da politica DISK_SCHED_DEADLINE, em milissegundos
+#define DISK_DEADLINE_READ   500
+#define DISK_DEADLINE_WRITE 5000
+
+// capacidade padrao do cache de blocos, em blocos (disk_set_cache_size ou
+// variavel de ambiente PPOS_DISK_CACHE; 0 desliga o cache)
+#define DISK_CACHE_DEFAULT 32
+
+// escrita adiada (write-back) pelo cache: disk_set_write_back ou variavel
+// de ambiente PPOS_DISK_WRITEBACK (0 ou 1); desligada por padrao. Com ela,
+// os blocos sujos so chegam ao disco pela descarga ou por disk_sync: o
+// programa deve chamar disk_sync antes de encerrar
+#define DISK_WRITE_BACK_DEFAULT 0
+
+// limites de buffers sujos, em % da capacidade do cache (disk_set_dirty_ratio):
+// acima de BACKGROUND a descarga comeca a gravar; em LIMIT os escritores
+// aguardam a descarga
+#define DISK_DIRTY_BACKGROUND 25
+#define DISK_DIRTY_LIMIT      50
+
+// intervalo maximo, em ms, que um bloco sujo abaixo de BACKGROUND aguarda
+// pela descarga
+#define DISK_FLUSH_INTERVAL 1000
+
+// leitura antecipada (read-ahead) pelo cache: apos DISK_READAHEAD_TRIGGER
+// leituras consecutivas de uma tarefa, os blocos seguintes sao lidos em
+// segundo plano; a janela comeca em DISK_READAHEAD_MIN blocos, cresce a
+// cada acerto e cai a metade a cada bloco antecipado descartado sem uso,
+// ate o maximo (disk_set_readahead ou variavel de ambiente
+// PPOS_DISK_READAHEAD, limitado a metade do cache; 0 desliga)
+#define DISK_READAHEAD_TRIGGER 2
+#define DISK_READAHEAD_MIN     2
+#define DISK_READAHEAD_DEFAULT 16
+
+// opcoes de disk_block_get e disk_block_get_for_write
+#define DISK_GET_NOWAIT    1   // nao espera: NULL se o bloco nao puder ser fixado ja
+#define DISK_GET_OVERWRITE 2   // (escrita) o bloco sera todo reescrito: nao le o disco
+
 // structura de dados que representa um pedido de leitura/escrita ao disco
 typedef struct diskrequest_t {
-    struct diskrequest_t* next;  // pre-requisito para usar a biblioteca queue.h
     struct diskrequest_t* prev;  // pre-requisito para usar a biblioteca queue.h
+    struct diskrequest_t* next;  // pre-requisito para usar a biblioteca queue.h
 
     // inserir os campos adicionais a partir daqui...
     task_t* task;
+    task_t* waitQueue;           // tarefa solicitante, suspensa ate a conclusao
+    struct diskrequest_t* blockNext;  // fila das requisicoes pendentes do mesmo bloco
+    struct diskrequest_t* blockPrev;
+    int status;                  // DISK_REQ_QUEUED, DISK_REQ_SERVING, DISK_REQ_DONE ou DISK_REQ_FAILED
     int op;
     void* buffer;
     int block;
     long launch_time;
     long start_time;
+    int policy;                  // politica que escolheu a requisicao
+    unsigned long seq;           // ordem de chegada entre todas as requisicoes
+    struct diskbuf_t* cache_buf; // leitura antecipada: buffer do cache a preencher
+                                 // (nao ha tarefa solicitante)
 
 } diskrequest_t;
 
@@ -37,6 +106,56 @@ typedef struct {
     int head_position;
     int total_steps;
     int total_time;
+
+    // slab de requisicoes (diskrequest_t)
+    int req_capacity;     // requisicoes alocadas no slab
+    int req_in_use;       // requisicoes pendentes no momento
+    int req_high_water;   // maximo de requisicoes pendentes simultaneas
+    int req_grows;        // vezes em que o slab precisou crescer
+
+    // escalonamento: total_steps e total_time repartidos pela politica
+    // concreta que escolheu cada requisicao
+    int sched_policy;                         // politica configurada (DISK_SCHED_*)
+    int sched_active;                         // politica concreta em uso
+    int sched_switches;                       // trocas de politica no modo adaptativo
+    int sched_requests[DISK_SCHED_POLICIES];  // requisicoes atendidas
+    int sched_steps[DISK_SCHED_POLICIES];     // blocos percorridos pela cabeca
+    int sched_time[DISK_SCHED_POLICIES];      // tempo de atendimento
+
+    // espera na fila (start_time - launch_time), por tipo de requisicao
+    int wait_count[DISK_REQ_TYPES];           // requisicoes despachadas
+    int wait_max[DISK_REQ_TYPES];             // maior espera, em ms
+    int wait_p99[DISK_REQ_TYPES];             // percentil 99 da espera, em ms (erro < 1/8)
+
+    // politica DISK_SCHED_DEADLINE
+    int deadline[DISK_REQ_TYPES];             // prazo de cada tipo, em ms
+    int deadline_promotions;                  // requisicoes atendidas por prazo vencido
+
+    // cache de blocos
+    int cache_capacity;   // blocos no cache (0: desligado)
+    int cache_hits;       // leituras atendidas pelo cache, sem acessar o disco
+    int cache_misses;     // leituras que precisaram do disco
+    int cache_evictions;  // blocos validos substituidos pelo CLOCK
+
+    // escrita adiada (write-back)
+    int cache_write_back;   // 1: escritas adiadas; 0: escrita direta
+    int dirty_background;   // % da capacidade em que a descarga comeca
+    int dirty_limit;        // % da capacidade em que os escritores aguardam
+    int cache_dirty;        // buffers sujos no momento
+    int cache_flushes;      // buffers sujos gravados no disco
+    int cache_absorbed;     // escritas sobre bloco ainda sujo, sem ir ao disco
+    int cache_throttled;    // escritas que aguardaram pelo limite de sujos
+
+    // leitura antecipada (eficiencia: ra_hits / ra_issued)
+    int ra_max;             // janela maxima, em blocos (0: desligada)
+    int ra_issued;          // blocos lidos antecipadamente
+    int ra_hits;            // leituras atendidas por blocos antecipados
+    int ra_wasted;          // blocos antecipados substituidos sem uso
+    int ra_saved;           // latencia de leitura poupada, em ms (estimada)
+
+    // acesso direto aos buffers (disk_block_get)
+    int cache_gets;         // blocos fixados
+    int cache_pinned;       // buffers fixados no momento
 } disk_t;
 
 // inicializacao do gerente de disco
@@ -45,12 +164,73 @@ typedef struct {
 // blockSize: tamanho de cada bloco do disco, em bytes
 int disk_mgr_init(int* numBlocks, int* blockSize);
 
+// define a capacidade do cache de blocos, em blocos (0 desliga o cache);
+// deve ser chamada antes de disk_mgr_init. Retorna -1 em erro ou 0
+int disk_set_cache_size(int blocks);
+
 // leitura de um bloco, do disco para o buffer
 int disk_block_read(int block, void* buffer);
 
-// escrita de um bloco, do buffer para o disco
+// escrita de um bloco, do buffer para o disco; com escrita adiada, retorna
+// quando o bloco esta no cache, e a gravacao no disco fica para a descarga
+// (ou para disk_block_sync/disk_sync)
 int disk_block_write(int block, void* buffer);
 
+// Acesso direto ao cache, sem copia: disk_block_get fixa o bloco no cache e
+// devolve o endereco do seu buffer, valido ate o disk_block_put
+// correspondente; um buffer fixado nao e substituido. Varias tarefas podem
+// fixar o mesmo bloco para leitura; disk_block_get_for_write o fixa com
+// exclusividade, e o conteudo alterado e considerado escrito (como por
+// disk_block_write) no disk_block_put. Uma tarefa nao deve fixar para
+// escrita um bloco que ela mesma ja tem fixado, nem acessar de novo um bloco
+// enquanto o tem fixado para escrita. Exigem o cache ligado
+
+// fixa o bloco para leitura (flags: DISK_GET_*); retorna o endereco do
+// bloco no cache, ou NULL em erro (sem cache ou sem buffer livre)
+const void* disk_block_get(int block, int flags);
+
+// fixa o bloco para escrita (flags: DISK_GET_*); retorna o endereco do
+// bloco no cache, ou NULL em erro
+void* disk_block_get_for_write(int block, int flags);
+
+// solta um bloco fixado, pelo endereco devolvido por disk_block_get ou
+// disk_block_get_for_write; retorna -1 em erro ou 0 em sucesso
+int disk_block_put(const void* data);
+
+// grava no disco o bloco, se estiver sujo no cache, retornando apos a
+// gravacao; retorna -1 em erro ou 0 em sucesso
+int disk_block_sync(int block);
+
+// grava no disco todos os blocos sujos no cache, em ordem crescente
+// retorna -1 em erro ou 0 em sucesso
+int disk_sync(void);
+
+// liga (1) ou desliga (0) a escrita adiada; deve ser chamada antes de
+// disk_mgr_init. Retorna -1 em erro ou 0
+int disk_set_write_back(int enable);
+
+// define a janela maxima da leitura antecipada, em blocos (0 a desliga)
+// retorna -1 em erro ou 0 em sucesso
+int disk_set_readahead(int max_blocks);
+
+// define os limites de buffers sujos, em % da capacidade do cache
+// (0 < background <= limit <= 100); retorna -1 em erro ou 0
+int disk_set_dirty_ratio(int background, int limit);
+
+// copia as estatisticas correntes do disco em stats
+int disk_mgr_stats(disk_t* stats);
+
+// escolhe a politica de escalonamento do disco (DISK_SCHED_*)
+// retorna -1 em erro ou 0 em sucesso
+int disk_set_scheduler(int policy);
+
+// define os prazos, em ms, da politica DISK_SCHED_DEADLINE
+// retorna -1 em erro ou 0 em sucesso
+int disk_set_deadline(int read_ms, int write_ms);
+
+// nome de uma politica de escalonamento, ou NULL se ela nao existir
+const char* disk_sched_name(int policy);
+
 // escalonador de requisições do disco
 diskrequest_t* disk_scheduler();
 
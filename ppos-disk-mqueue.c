@@ -0,0 +1,322 @@
+#include "ppos.h"
+#include "ppos-core-globals.h"
+#include "disk-driver.h"
+#include "ppos-disk-manager.h"
+#include "ppos-disk-mqueue.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* ============================================================
+ * Formato dos Blocos do Log
+   ============================================================
+ */
+
+#define DMQUEUE_MAGIC 0x51514d50  // "PMQQ"
+
+// cabecalho gravado no inicio de cada bloco do log
+typedef struct {
+    unsigned int magic;
+    unsigned short count;           // mensagens no bloco
+    unsigned short messageSize;
+    unsigned int seq;               // sequencia do bloco no log
+    unsigned int headId;            // posicao de leitura da fila quando gravado
+} dmqueue_hdr_t;
+
+// endereco da mensagem de numero id na imagem de um bloco
+static unsigned char *dmqueue_msg_addr(dmqueue_t *queue, unsigned char *block, unsigned int id) {
+    return block + sizeof(dmqueue_hdr_t) + (id % queue->perBlock) * queue->messageSize;
+}
+
+// bloco do disco onde fica o bloco de sequencia seq do log
+static int dmqueue_disk_block(dmqueue_t *queue, unsigned int seq) {
+    return queue->firstBlock + seq % queue->numBlocks;
+}
+
+// o bloco de sequencia seq pode ser gravado se o bloco que ele sobrescreve
+// (seq - numBlocks) ja foi totalmente recebido
+static int dmqueue_has_room(dmqueue_t *queue, unsigned int seq) {
+    return seq - queue->headId / queue->perBlock < (unsigned int) queue->numBlocks;
+}
+
+// acorda todos os emissores em espera, que reavaliam sua condicao
+// (deve ser chamada com preempcao desabilitada)
+static void dmqueue_wake(dmqueue_t *queue) {
+    while (queue->waitQueue != NULL) {
+        task_resume(queue->waitQueue);
+    }
+}
+
+// suspende a tarefa corrente ate a proxima gravacao ou recepcao
+// (chamada com preempcao desabilitada; retorna com ela desabilitada)
+static void dmqueue_wait(dmqueue_t *queue) {
+    task_suspend(taskExec, &(queue->waitQueue));
+    PPOS_PREEMPT_ENABLE;
+    task_yield();
+    PPOS_PREEMPT_DISABLE;
+}
+
+/* ============================================================
+ * Gravacao em Grupo (group commit)
+   ============================================================
+ */
+
+// grava a imagem do bloco aberto, com todas as mensagens acumuladas ate aqui
+// e a posicao de leitura corrente; as mensagens gravadas ficam disponiveis
+// aos receptores. Chamada com preempcao desabilitada e sem outra gravacao
+// em andamento; retorna com ela desabilitada
+static void dmqueue_flush(dmqueue_t *queue) {
+    dmqueue_hdr_t *hdr = (dmqueue_hdr_t *) queue->image;
+    unsigned int target = queue->seq * queue->perBlock + queue->count;
+    unsigned int seq = queue->seq;
+    int durable;
+
+    hdr->magic = DMQUEUE_MAGIC;
+    hdr->count = queue->count;
+    hdr->messageSize = queue->messageSize;
+    hdr->seq = seq;
+    hdr->headId = queue->headId;
+    memcpy(queue->writeBuf, queue->image, queue->blockSize);
+    queue->syncedHeadId = queue->headId;
+    queue->flushing = 1;
+    PPOS_PREEMPT_ENABLE;
+
+    // com o cache em escrita adiada, o bloco so esta no disco apos o sync
+    disk_block_write(dmqueue_disk_block(queue, seq), queue->writeBuf);
+    disk_block_sync(dmqueue_disk_block(queue, seq));
+
+    PPOS_PREEMPT_DISABLE;
+    durable = target - queue->durableId;
+    queue->durableId = target;
+    queue->flushing = 0;
+    queue->writes++;
+    dmqueue_wake(queue);
+    PPOS_PREEMPT_ENABLE;
+    if (durable > 0) {
+        sem_up_n(&(queue->sItem), durable);
+    }
+    PPOS_PREEMPT_DISABLE;
+}
+
+/* ============================================================
+ * Abertura e Recuperacao
+   ============================================================
+ */
+
+int dmqueue_open(dmqueue_t *queue, int firstBlock, int numBlocks, int size) {
+    unsigned char *valid;
+    unsigned int *seqs;
+    int found = -1, i;
+
+    if (queue == NULL || numBlocks < 2 || size <= 0 || firstBlock < 0)
+        return -1;
+
+    queue->blockSize = disk_cmd(DISK_CMD_BLOCKSIZE, 0, 0);
+    if (queue->blockSize <= (int) sizeof(dmqueue_hdr_t) ||
+        firstBlock + numBlocks > disk_cmd(DISK_CMD_DISKSIZE, 0, 0))
+        return -1;
+
+    queue->firstBlock = firstBlock;
+    queue->numBlocks = numBlocks;
+    queue->messageSize = size;
+    queue->perBlock = (queue->blockSize - sizeof(dmqueue_hdr_t)) / size;
+    if (queue->perBlock < 1)
+        return -1;
+
+    queue->image = calloc(1, queue->blockSize);
+    queue->writeBuf = malloc(queue->blockSize);
+    queue->readBuf = malloc(queue->blockSize);
+    valid = calloc(numBlocks, sizeof(unsigned char));
+    seqs = malloc(numBlocks * sizeof(unsigned int));
+    if (!queue->image || !queue->writeBuf || !queue->readBuf || !valid || !seqs) {
+        free(queue->image);
+        free(queue->writeBuf);
+        free(queue->readBuf);
+        free(valid);
+        free(seqs);
+        return -1;
+    }
+
+    // varre o log, procurando o bloco gravado mais recentemente
+    for (i = 0; i < numBlocks; i++) {
+        dmqueue_hdr_t *hdr = (dmqueue_hdr_t *) queue->readBuf;
+        disk_block_read(firstBlock + i, queue->readBuf);
+        if (hdr->magic != DMQUEUE_MAGIC || hdr->messageSize != size ||
+            hdr->count > queue->perBlock || hdr->seq % numBlocks != (unsigned int) i)
+            continue;
+        valid[i] = 1;
+        seqs[i] = hdr->seq;
+        if (found < 0 || hdr->seq > seqs[found]) {
+            found = i;
+            memcpy(queue->image, queue->readBuf, queue->blockSize);
+        }
+    }
+
+    if (found < 0) {
+        queue->seq = 0;
+        queue->count = 0;
+        queue->headId = 0;
+    } else {
+        dmqueue_hdr_t *hdr = (dmqueue_hdr_t *) queue->image;
+        unsigned int first = hdr->seq;
+
+        queue->seq = hdr->seq;
+        queue->count = hdr->count;
+        queue->headId = hdr->headId;
+
+        // as mensagens validas vao do bloco mais recente ate o primeiro
+        // bloco anterior ausente ou sobrescrito
+        while (first > 0 && queue->seq - (first - 1) < (unsigned int) numBlocks) {
+            int slot = (first - 1) % numBlocks;
+            if (!valid[slot] || seqs[slot] != first - 1)
+                break;
+            first--;
+        }
+        if (queue->headId < first * queue->perBlock)
+            queue->headId = first * queue->perBlock;
+    }
+    free(valid);
+    free(seqs);
+
+    queue->durableId = queue->seq * queue->perBlock + queue->count;
+    if (queue->headId > queue->durableId)
+        queue->headId = queue->durableId;
+    queue->syncedHeadId = queue->headId;
+    queue->readValid = 0;
+    queue->flushing = 0;
+    queue->waitQueue = NULL;
+    queue->sends = 0;
+    queue->writes = 0;
+    sem_create(&(queue->sItem), queue->durableId - queue->headId);
+    mutex_create(&(queue->readLock));
+    queue->active = 1;
+    return queue->durableId - queue->headId;
+}
+
+/* ============================================================
+ * Envio e Recepcao
+   ============================================================
+ */
+
+int dmqueue_send(dmqueue_t *queue, void *msg) {
+    unsigned int id;
+
+    if (queue == NULL || !queue->active || msg == NULL)
+        return -1;
+
+    PPOS_PREEMPT_DISABLE;
+    while (queue->active) {
+        // bloco aberto cheio e ja gravado: abre o proximo, se houver espaco
+        if (queue->count == (unsigned int) queue->perBlock &&
+            queue->durableId == (queue->seq + 1) * queue->perBlock &&
+            dmqueue_has_room(queue, queue->seq + 1)) {
+            queue->seq++;
+            queue->count = 0;
+        }
+        if (queue->count < (unsigned int) queue->perBlock)
+            break;
+        // bloco cheio ainda nao gravado: grava-o, se o disco estiver livre
+        if (!queue->flushing && queue->durableId < (queue->seq + 1) * queue->perBlock)
+            dmqueue_flush(queue);
+        else
+            dmqueue_wait(queue);
+    }
+    if (!queue->active) {
+        PPOS_PREEMPT_ENABLE;
+        return -1;
+    }
+
+    id = queue->seq * queue->perBlock + queue->count;
+    memcpy(dmqueue_msg_addr(queue, queue->image, id), msg, queue->messageSize);
+    queue->count++;
+    queue->sends++;
+
+    // aguarda a mensagem chegar ao disco; quem encontra o disco livre grava
+    // de uma vez todas as mensagens acumuladas enquanto ele estava ocupado
+    while (queue->active && queue->durableId <= id) {
+        if (!queue->flushing)
+            dmqueue_flush(queue);
+        else
+            dmqueue_wait(queue);
+    }
+    PPOS_PREEMPT_ENABLE;
+    return queue->durableId > id ? 0 : -1;
+}
+
+int dmqueue_recv(dmqueue_t *queue, void *msg) {
+    unsigned int id, seq;
+    unsigned char *block;
+
+    if (queue == NULL || !queue->active || msg == NULL)
+        return -1;
+    if (sem_down(&(queue->sItem)) < 0)
+        return -1;
+    if (mutex_lock(&(queue->readLock)) < 0)
+        return -1;
+
+    PPOS_PREEMPT_DISABLE;
+    id = queue->headId;
+    seq = id / queue->perBlock;
+    if (seq == queue->seq) {
+        block = queue->image;
+    } else {
+        // bloco ja fechado: nao sera mais regravado enquanto nao for recebido
+        if (!queue->readValid || queue->readSeq != seq) {
+            PPOS_PREEMPT_ENABLE;
+            disk_block_read(dmqueue_disk_block(queue, seq), queue->readBuf);
+            PPOS_PREEMPT_DISABLE;
+            queue->readSeq = seq;
+            queue->readValid = 1;
+        }
+        block = queue->readBuf;
+    }
+    memcpy(msg, dmqueue_msg_addr(queue, block, id), queue->messageSize);
+    queue->headId++;
+    // um bloco inteiro foi recebido: libera espaco no log
+    if (queue->headId % queue->perBlock == 0)
+        dmqueue_wake(queue);
+    PPOS_PREEMPT_ENABLE;
+
+    mutex_unlock(&(queue->readLock));
+    return 0;
+}
+
+int dmqueue_sync(dmqueue_t *queue) {
+    if (queue == NULL || !queue->active)
+        return -1;
+
+    PPOS_PREEMPT_DISABLE;
+    while (queue->flushing)
+        dmqueue_wait(queue);
+    if (queue->syncedHeadId != queue->headId ||
+        queue->durableId != queue->seq * queue->perBlock + queue->count)
+        dmqueue_flush(queue);
+    PPOS_PREEMPT_ENABLE;
+    return 0;
+}
+
+int dmqueue_msgs(dmqueue_t *queue) {
+    if (queue == NULL || !queue->active)
+        return -1;
+    return queue->durableId - queue->headId;
+}
+
+int dmqueue_close(dmqueue_t *queue) {
+    if (queue == NULL || !queue->active)
+        return -1;
+
+    dmqueue_sync(queue);
+
+    PPOS_PREEMPT_DISABLE;
+    queue->active = 0;
+    dmqueue_wake(queue);
+    PPOS_PREEMPT_ENABLE;
+
+    sem_destroy(&(queue->sItem));
+    mutex_destroy(&(queue->readLock));
+    free(queue->image);
+    free(queue->writeBuf);
+    free(queue->readBuf);
+    queue->image = queue->writeBuf = queue->readBuf = NULL;
+    return 0;
+}
@@ -0,0 +1,68 @@
+// PingPongOS - PingPong Operating System
+
+// interface da fila de mensagens persistente (gravada no disco)
+
+#ifndef __DISK_MQUEUE__
+#define __DISK_MQUEUE__
+
+// A fila grava as mensagens em um log circular ocupando os blocos
+// [firstBlock, firstBlock + numBlocks) do disco, por meio do gerente de
+// disco. Cada bloco do log tem um cabecalho e ate perBlock mensagens de
+// tamanho fixo; a mensagem de numero id fica sempre no bloco de sequencia
+// id / perBlock, que e gravado no bloco firstBlock + (sequencia % numBlocks)
+// da regiao. Esse mapeamento e o indice em memoria usado pelas leituras.
+//
+// Envios concorrentes sao agrupados (group commit): enquanto um bloco esta
+// sendo gravado, os novos envios se acumulam na imagem do bloco aberto e sao
+// gravados juntos na proxima escrita. Um envio so retorna quando sua
+// mensagem esta no disco. A posicao de leitura e gravada junto com o
+// proximo bloco escrito (ou por dmqueue_sync); apos uma reinicializacao, as
+// mensagens recebidas depois dessa gravacao sao entregues novamente.
+
+// estrutura que define uma fila de mensagens persistente
+typedef struct {
+    int firstBlock;                 // primeiro bloco da regiao do log
+    int numBlocks;                  // blocos da regiao do log
+    int blockSize;
+    int messageSize;
+    int perBlock;                   // mensagens por bloco do log
+    unsigned int seq;               // sequencia do bloco aberto (recebendo mensagens)
+    unsigned int count;             // mensagens no bloco aberto
+    unsigned int headId;            // proxima mensagem a ser recebida
+    unsigned int durableId;         // mensagens com id menor ja estao no disco
+    unsigned int syncedHeadId;      // headId gravado no ultimo bloco escrito
+    unsigned char *image;           // imagem do bloco aberto
+    unsigned char *writeBuf;        // copia da imagem sendo gravada no disco
+    unsigned char *readBuf;         // ultimo bloco do log lido do disco
+    unsigned int readSeq;           // sequencia do bloco em readBuf
+    unsigned char readValid;
+    unsigned char flushing;         // ha uma gravacao em andamento
+    struct task_t *waitQueue;       // emissores aguardando gravacao ou espaco no log
+    semaphore_t sItem;              // mensagens gravadas ainda nao recebidas
+    mutex_t readLock;               // serializa as leituras do log
+    unsigned long sends;            // mensagens enviadas
+    unsigned long writes;           // blocos gravados (sends/writes = tamanho medio do lote)
+    unsigned char active;
+} dmqueue_t;
+
+// abre a fila persistente na regiao indicada do disco, reconstruindo seu
+// conteudo a partir do log ja gravado; deve ser chamada apos disk_mgr_init.
+// Retorna -1 em erro ou o numero de mensagens recuperadas
+int dmqueue_open(dmqueue_t *queue, int firstBlock, int numBlocks, int size);
+
+// envia uma mensagem, retornando apos ela ter sido gravada no disco
+int dmqueue_send(dmqueue_t *queue, void *msg);
+
+// recebe a mensagem mais antiga da fila
+int dmqueue_recv(dmqueue_t *queue, void *msg);
+
+// grava no disco a posicao de leitura corrente da fila
+int dmqueue_sync(dmqueue_t *queue);
+
+// informa o numero de mensagens gravadas e ainda nao recebidas
+int dmqueue_msgs(dmqueue_t *queue);
+
+// grava a posicao de leitura e fecha a fila, liberando as tarefas bloqueadas
+int dmqueue_close(dmqueue_t *queue);
+
+#endif
@@ -142,11 +142,22 @@ int sem_up (semaphore_t *s) ;
 int before_sem_up (semaphore_t *s) ;
 int after_sem_up (semaphore_t *s) ;
 
+// requisita k unidades do semáforo de uma só vez (sem aquisição parcial)
+int sem_down_n (semaphore_t *s, int k) ;
+
+// libera k unidades do semáforo, acordando todas as tarefas que puderem
+// ser atendidas
+int sem_up_n (semaphore_t *s, int k) ;
+
 // destroi o semáforo, liberando as tarefas bloqueadas
 int sem_destroy (semaphore_t *s) ;
 int before_sem_destroy (semaphore_t *s) ;
 int after_sem_destroy (semaphore_t *s) ;
 
+// define a ordem de atendimento das tarefas em espera no semáforo
+// (PPOS_WAIT_FIFO ou PPOS_WAIT_PRIO); só pode ser alterada com a fila vazia
+int sem_setorder (semaphore_t *s, int order) ;
+
 // mutexes
 
 // Inicializa um mutex (sempre inicialmente livre)
@@ -169,6 +180,28 @@ int mutex_destroy (mutex_t *m) ;
 int before_mutex_destroy (mutex_t *m) ;
 int after_mutex_destroy (mutex_t *m) ;
 
+// variáveis de condição
+
+// Inicializa uma variável de condição
+int cond_create (cond_t *c) ;
+
+// Libera o mutex m e aguarda a sinalização da condição; ao retornar 0,
+// a tarefa corrente detém novamente o mutex m (-1: erro, sem alterar a
+// posse do mutex, ou mutex destruído durante a espera)
+int cond_wait (cond_t *c, mutex_t *m) ;
+
+// Transfere uma tarefa em espera na condição para a fila do mutex associado
+int cond_signal (cond_t *c) ;
+
+// Transfere todas as tarefas em espera para a fila do mutex associado
+// (somente uma delas é acordada a cada mutex_unlock)
+int cond_broadcast (cond_t *c) ;
+
+// Destrói a variável de condição, liberando as tarefas bloqueadas como em
+// cond_broadcast: elas retornam 0 de cond_wait com o mutex, e devem
+// verificar o estado que ele protege
+int cond_destroy (cond_t *c) ;
+
 // barreiras
 
 // Inicializa uma barreira
@@ -186,6 +219,11 @@ int barrier_destroy (barrier_t *b) ;
 int before_barrier_destroy (barrier_t *b) ;
 int after_barrier_destroy (barrier_t *b) ;
 
+// Copia para hist as n primeiras faixas do histograma de espera por fase
+// (faixa i: espera em [2^(i-1), 2^i) ms; faixa 0: menos de 1 ms).
+// Retorna o número de fases concluídas ou -1 em erro
+int barrier_histogram (barrier_t *b, unsigned int *hist, int n) ;
+
 // filas de mensagens
 
 // cria uma fila para até max mensagens de size bytes cada
@@ -203,6 +241,51 @@ int mqueue_recv (mqueue_t *queue, void *msg) ;
 int before_mqueue_recv (mqueue_t *queue, void *msg) ;
 int after_mqueue_recv (mqueue_t *queue, void *msg) ;
 
+// envia n mensagens consecutivas de msgs (n * size bytes), acordando os
+// receptores uma vez por lote. Retorna n, ou o número de mensagens já
+// enviadas se a fila for destruída no meio (-1 se nenhuma foi enviada)
+int mqueue_send_n (mqueue_t *queue, void *msgs, int n) ;
+
+// recebe em out todas as mensagens disponíveis, até max, bloqueando somente
+// até haver min mensagens na fila. Retorna o número de mensagens recebidas,
+// ou -1 em erro (nenhuma mensagem é retirada da fila nesse caso)
+int mqueue_recv_n (mqueue_t *queue, void *out, int max, int min) ;
+
+// reserva uma posição livre da fila, onde a mensagem é escrita
+// diretamente; retorna o endereço da posição ou NULL em erro
+void *mqueue_reserve (mqueue_t *queue) ;
+
+// publica a posição reservada pela tarefa corrente
+int mqueue_commit (mqueue_t *queue) ;
+
+// empresta a mensagem mais antiga da fila, sem copiá-la; retorna o
+// endereço da mensagem ou NULL em erro
+const void *mqueue_peek (mqueue_t *queue) ;
+
+// devolve à fila a posição emprestada pela tarefa corrente
+int mqueue_release (mqueue_t *queue) ;
+
+// cria uma fila de mensagens de tamanho variável, guardadas em um anel de
+// capacity bytes (cada mensagem ocupa seu tamanho mais um cabeçalho)
+int mqueue_create_var (mqueue_t *queue, int capacity) ;
+
+// envia uma mensagem de len bytes para uma fila de tamanho variável
+int mqueue_send_var (mqueue_t *queue, const void *msg, int len) ;
+
+// recebe uma mensagem de uma fila de tamanho variável em msg, que tem maxlen
+// bytes. Retorna o tamanho da mensagem ou -1 em erro (inclusive se a
+// mensagem não couber em msg, caso em que ela permanece na fila)
+int mqueue_recv_var (mqueue_t *queue, void *msg, int maxlen) ;
+
+// cria uma fila de até max mensagens de size bytes com MQUEUE_PRIO_LEVELS
+// níveis de prioridade; mqueue_recv entrega a mensagem mais antiga do nível
+// mais urgente e mqueue_send envia no nível 0
+int mqueue_create_prio (mqueue_t *queue, int max, int size) ;
+
+// envia uma mensagem no nível prio (0 a MQUEUE_PRIO_LEVELS-1, maior é mais
+// urgente) de uma fila criada com mqueue_create_prio
+int mqueue_send_prio (mqueue_t *queue, void *msg, int prio) ;
+
 // destroi a fila, liberando as tarefas bloqueadas
 int mqueue_destroy (mqueue_t *queue) ;
 int before_mqueue_destroy (mqueue_t *queue) ;
@@ -213,6 +296,47 @@ int mqueue_msgs (mqueue_t *queue) ;
 int before_mqueue_msgs (mqueue_t *queue) ;
 int after_mqueue_msgs (mqueue_t *queue) ;
 
+// define a ordem de atendimento das tarefas bloqueadas na fila
+// (PPOS_WAIT_FIFO ou PPOS_WAIT_PRIO)
+int mqueue_setorder (mqueue_t *queue, int order) ;
+
+// tópicos publica/assina
+
+// cria um tópico com um anel de max mensagens de size bytes; policy define o
+// tratamento de assinantes atrasados (TOPIC_BLOCK ou TOPIC_DROP_OLDEST)
+int topic_create (topic_t *topic, int max, int size, int policy) ;
+
+// publica uma mensagem, copiada uma única vez para todos os assinantes
+int topic_publish (topic_t *topic, void *msg) ;
+
+// assina o tópico; o assinante recebe as mensagens publicadas a partir daqui
+int topic_subscribe (topic_t *topic, topic_sub_t *sub) ;
+
+// cancela a assinatura, liberando as mensagens ainda não lidas
+int topic_unsubscribe (topic_sub_t *sub) ;
+
+// recebe (copia) a próxima mensagem do assinante
+int topic_recv (topic_sub_t *sub, void *msg) ;
+
+// empresta a próxima mensagem do assinante, sem copiá-la; retorna o
+// endereço da mensagem no anel ou NULL em erro
+const void *topic_peek (topic_sub_t *sub) ;
+
+// devolve a mensagem emprestada por topic_peek e avança o cursor
+int topic_release (topic_sub_t *sub) ;
+
+// destroi o tópico, liberando as tarefas bloqueadas
+int topic_destroy (topic_t *topic) ;
+
+// espera múltipla
+
+// bloqueia a tarefa corrente até que um dos n objetos (semáforos ou filas
+// de mensagens) fique pronto ou até timeout ms (0: não bloqueia; < 0: sem
+// limite). Retorna o índice do objeto pronto ou -1 em timeout/erro, inclusive
+// objeto destruído antes ou durante a espera. O objeto não é consumido: a
+// tarefa deve em seguida chamar sem_down/mqueue_recv
+int ppos_wait_any (ppos_object_t objects[], int n, int timeout) ;
+
 // funcao para debug. imprime os campos da estrutura task_t
 void print_tcb( task_t* task );
 
@@ -0,0 +1,308 @@
+//------------------------------------------------------------------------------
+// Operações em uma fila genérica (ver queue.h).
+//
+// Versão normal: todas as operações de inserção e remoção são O(1); são
+// verificadas apenas as condições que não exigem percorrer a fila (fila e
+// elemento existentes, elemento desencadeado ao inserir e encadeado ao
+// remover). Cabe ao chamador garantir que o elemento removido pertence à
+// fila indicada.
+//
+// Versão de depuração (compilada com QUEUE_DEBUG, ver makefile): verifica
+// todas as condições de queue.h, gerando mensagens de erro em stderr, e a
+// integridade dos encadeamentos da fila a cada operação. A pertinência de
+// um elemento é conferida pela sua etiqueta (a fila onde ele está), sem
+// percorrer a fila. Como o formato de queue_t é compartilhado com o núcleo
+// pré-compilado e não pode crescer, as etiquetas ficam em uma tabela hash
+// indexada pelo endereço do elemento.
+//------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include "queue.h"
+
+#ifdef QUEUE_DEBUG
+
+#include <stdint.h>
+#include <stdlib.h>
+
+//------------------------------------------------------------------------------
+// etiquetas de pertinência (somente na versão de depuração)
+
+typedef struct
+{
+   queue_t *elem ;      // NULL: posição livre; QUEUE_TAG_DELETED: removida
+   queue_t **queue ;    // fila onde o elemento está
+} queue_tag_t ;
+
+#define QUEUE_TAG_DELETED ((queue_t *) 1)
+
+static queue_tag_t *tags = NULL ;
+static size_t tagCapacity = 0 ;   // potência de 2
+static size_t tagUsed = 0 ;       // posições ocupadas ou removidas
+static size_t tagCount = 0 ;      // elementos em alguma fila
+
+static size_t tag_hash (queue_t *elem)
+{
+   uintptr_t h = (uintptr_t) elem ;
+   h ^= h >> 17 ;
+   h *= 0x9e3779b97f4a7c15ULL ;
+   return (size_t) (h ^ (h >> 29)) & (tagCapacity - 1) ;
+}
+
+// posição da etiqueta do elemento, ou NULL se ele não está em fila alguma
+static queue_tag_t *tag_find (queue_t *elem)
+{
+   size_t i ;
+
+   if (!tagCapacity)
+      return NULL ;
+   for (i = tag_hash (elem); tags[i].elem != NULL; i = (i + 1) & (tagCapacity - 1))
+      if (tags[i].elem == elem)
+         return &tags[i] ;
+   return NULL ;
+}
+
+static void tag_set (queue_t *elem, queue_t **queue) ;
+
+static void tag_grow (void)
+{
+   queue_tag_t *old = tags ;
+   size_t oldCapacity = tagCapacity, i ;
+
+   tagCapacity = tagCapacity ? tagCapacity * 2 : 64 ;
+   while (tagCount * 2 >= tagCapacity)
+      tagCapacity *= 2 ;
+   tags = calloc (tagCapacity, sizeof (queue_tag_t)) ;
+   if (!tags)
+   {
+      perror ("### queue: etiquetas") ;
+      exit (1) ;
+   }
+   tagUsed = tagCount = 0 ;
+   for (i = 0; i < oldCapacity; i++)
+      if (old[i].elem != NULL && old[i].elem != QUEUE_TAG_DELETED)
+         tag_set (old[i].elem, old[i].queue) ;
+   free (old) ;
+}
+
+// marca o elemento como pertencente à fila (o elemento não tem etiqueta)
+static void tag_set (queue_t *elem, queue_t **queue)
+{
+   size_t i ;
+
+   if ((tagUsed + 1) * 2 >= tagCapacity)
+      tag_grow () ;
+   for (i = tag_hash (elem); tags[i].elem != NULL && tags[i].elem != QUEUE_TAG_DELETED;
+        i = (i + 1) & (tagCapacity - 1)) ;
+   if (tags[i].elem == NULL)
+      tagUsed++ ;
+   tags[i].elem = elem ;
+   tags[i].queue = queue ;
+   tagCount++ ;
+}
+
+static void tag_clear (queue_tag_t *tag)
+{
+   tag->elem = QUEUE_TAG_DELETED ;
+   tag->queue = NULL ;
+   tagCount-- ;
+}
+
+//------------------------------------------------------------------------------
+// verificação de integridade: encadeamentos consistentes e todos os
+// elementos etiquetados com esta fila
+
+static void queue_check (const char *op, queue_t **queue)
+{
+   queue_t *elem = *queue ;
+   size_t steps = 0 ;
+   queue_tag_t *tag ;
+
+   if (elem == NULL)
+      return ;
+   do
+   {
+      if (elem->next == NULL || elem->prev == NULL ||
+          elem->next->prev != elem || elem->prev->next != elem)
+      {
+         fprintf (stderr, "### %s: fila %p com encadeamento inconsistente em %p\n",
+                  op, (void *) queue, (void *) elem) ;
+         return ;
+      }
+      tag = tag_find (elem) ;
+      if (!tag || tag->queue != queue)
+      {
+         fprintf (stderr, "### %s: elemento %p na fila %p sem etiqueta desta fila\n",
+                  op, (void *) elem, (void *) queue) ;
+         return ;
+      }
+      if (++steps > tagCount)
+      {
+         fprintf (stderr, "### %s: fila %p nao volta ao primeiro elemento\n",
+                  op, (void *) queue) ;
+         return ;
+      }
+      elem = elem->next ;
+   } while (elem != *queue) ;
+}
+
+#endif // QUEUE_DEBUG
+
+//------------------------------------------------------------------------------
+// As filas nuas (queue_t *) sao encadeadas pelas operacoes de queue_head_t,
+// sobre uma cabeca temporaria: o nucleo pre-compilado guarda apenas o
+// apontador para o primeiro elemento, sem lugar para o contador.
+
+static void bare_append (queue_t **queue, queue_t *elem)
+{
+   queue_head_t head = { *queue, 0 } ;
+
+   queue_head_append (&head, elem) ;
+   *queue = head.first ;
+}
+
+static void bare_remove (queue_t **queue, queue_t *elem)
+{
+   queue_head_t head = { *queue, 0 } ;
+
+   queue_head_remove (&head, elem) ;
+   *queue = head.first ;
+}
+
+//------------------------------------------------------------------------------
+
+void queue_append (queue_t **queue, queue_t *elem)
+{
+#ifdef QUEUE_DEBUG
+   if (!queue)
+   {
+      fprintf (stderr, "### queue_append: a fila nao existe\n") ;
+      return ;
+   }
+   if (!elem)
+   {
+      fprintf (stderr, "### queue_append: o elemento nao existe\n") ;
+      return ;
+   }
+   if (tag_find (elem) || elem->prev || elem->next)
+   {
+      fprintf (stderr, "### queue_append: o elemento %p ja esta em uma fila\n", (void *) elem) ;
+      return ;
+   }
+   queue_check ("queue_append", queue) ;
+#else
+   if (!queue || !elem || elem->prev || elem->next)
+      return ;
+#endif
+
+   bare_append (queue, elem) ;
+
+#ifdef QUEUE_DEBUG
+   tag_set (elem, queue) ;
+#endif
+}
+
+//------------------------------------------------------------------------------
+
+queue_t *queue_remove (queue_t **queue, queue_t *elem)
+{
+#ifdef QUEUE_DEBUG
+   queue_tag_t *tag ;
+
+   if (!queue)
+   {
+      fprintf (stderr, "### queue_remove: a fila nao existe\n") ;
+      return NULL ;
+   }
+   if (!*queue)
+   {
+      fprintf (stderr, "### queue_remove: a fila %p esta vazia\n", (void *) queue) ;
+      return NULL ;
+   }
+   if (!elem)
+   {
+      fprintf (stderr, "### queue_remove: o elemento nao existe\n") ;
+      return NULL ;
+   }
+   tag = tag_find (elem) ;
+   if (!tag || tag->queue != queue)
+   {
+      fprintf (stderr, "### queue_remove: o elemento %p nao pertence a fila %p\n",
+               (void *) elem, (void *) queue) ;
+      return NULL ;
+   }
+   queue_check ("queue_remove", queue) ;
+   tag_clear (tag) ;
+#else
+   if (!queue || !*queue || !elem || !elem->next)
+      return NULL ;
+#endif
+
+   bare_remove (queue, elem) ;
+   return elem ;
+}
+
+//------------------------------------------------------------------------------
+
+void queue_splice (queue_t **dst, queue_t **src)
+{
+   queue_t *first, *last ;
+
+   if (!dst || !src || !*src || dst == src)
+      return ;
+
+#ifdef QUEUE_DEBUG
+   queue_check ("queue_splice", dst) ;
+   queue_check ("queue_splice", src) ;
+   first = *src ;
+   do
+   {
+      queue_tag_t *tag = tag_find (first) ;
+      if (tag)
+         tag->queue = dst ;
+      first = first->next ;
+   } while (first != *src) ;
+#endif
+
+   first = *src ;
+   if (*dst == NULL)
+      *dst = first ;
+   else
+   {
+      last = first->prev ;
+      (*dst)->prev->next = first ;
+      first->prev = (*dst)->prev ;
+      last->next = *dst ;
+      (*dst)->prev = last ;
+   }
+   *src = NULL ;
+}
+
+//------------------------------------------------------------------------------
+
+int queue_size (queue_t *queue)
+{
+   queue_t *elem ;
+   int size ;
+
+   if (!queue || !queue->next)
+      return 0 ;
+   for (size = 1, elem = queue; elem->next != queue; elem = elem->next)
+      size++ ;
+   return size ;
+}
+
+//------------------------------------------------------------------------------
+
+void queue_print (char *name, queue_t *queue, void print_elem (void*) )
+{
+   queue_t *elem = queue ;
+
+   printf ("%s: Size = %d [", name, queue_size (queue)) ;
+   if (elem)
+   {
+      for (; elem->next != queue; elem = elem->next)
+         print_elem (elem) ;
+      print_elem (elem) ;
+   }
+   printf ("]\n") ;
+}
@@ -20,6 +20,11 @@ typedef struct queue_t
    struct queue_t *next ;  // aponta para o elemento seguinte na fila
 } queue_t ;
 
+//------------------------------------------------------------------------------
+// As condicoes que exigem percorrer a fila (elemento em outra fila, elemento
+// pertencente a fila) so sao verificadas na versao de depuracao da
+// biblioteca (make QUEUE_DEBUG=1); na versao normal, as operacoes sao O(1).
+
 //------------------------------------------------------------------------------
 // Insere um elemento no final da fila.
 // Condicoes a verificar, gerando msgs de erro:
@@ -40,6 +45,12 @@ void queue_append (queue_t **queue, queue_t *elem) ;
 
 queue_t *queue_remove (queue_t **queue, queue_t *elem) ;
 
+//------------------------------------------------------------------------------
+// Move todos os elementos da fila src para o final da fila dst, em O(1),
+// deixando src vazia.
+
+void queue_splice (queue_t **dst, queue_t **src) ;
+
 //------------------------------------------------------------------------------
 // Conta o numero de elementos na fila
 // Retorno: numero de elementos na fila
@@ -55,4 +66,100 @@ int queue_size (queue_t *queue) ;
 
 void queue_print (char *name, queue_t *queue, void print_elem (void*) ) ;
 
+//------------------------------------------------------------------------------
+// Cabeça de fila com contador: inserção, remoção e retirada em O(1).
+// A fila continua circular e duplamente encadeada (first->prev é o último
+// elemento), no mesmo formato das funções acima, que são implementadas
+// sobre estas. Para não percorrer a fila,
+// as operações não verificam as condições: cabe ao chamador garantir que o
+// elemento não está em outra fila ao inserir e que pertence a esta ao remover.
+// Após a remoção, prev e next do elemento ficam nulos, como em queue_remove.
+
+typedef struct queue_head_t
+{
+   queue_t *first ;  // primeiro elemento da fila (NULL se vazia)
+   int count ;       // número de elementos na fila
+} queue_head_t ;
+
+#define QUEUE_HEAD_INIT { NULL, 0 }
+
+static inline void queue_head_init (queue_head_t *head)
+{
+   head->first = NULL ;
+   head->count = 0 ;
+}
+
+static inline int queue_head_size (const queue_head_t *head)
+{
+   return head->count ;
+}
+
+// insere o elemento no final da fila
+static inline void queue_head_append (queue_head_t *head, queue_t *elem)
+{
+   if (head->first == NULL)
+   {
+      elem->prev = elem->next = elem ;
+      head->first = elem ;
+   }
+   else
+   {
+      queue_t *last = head->first->prev ;
+      elem->prev = last ;
+      elem->next = head->first ;
+      last->next = elem ;
+      head->first->prev = elem ;
+   }
+   head->count++ ;
+}
+
+// remove o elemento indicado da fila, sem o destruir
+static inline queue_t *queue_head_remove (queue_head_t *head, queue_t *elem)
+{
+   if (elem->next == elem)
+      head->first = NULL ;
+   else
+   {
+      elem->prev->next = elem->next ;
+      elem->next->prev = elem->prev ;
+      if (head->first == elem)
+         head->first = elem->next ;
+   }
+   elem->prev = elem->next = NULL ;
+   head->count-- ;
+   return elem ;
+}
+
+// retira o primeiro elemento da fila; retorna NULL se ela estiver vazia
+static inline queue_t *queue_head_pop (queue_head_t *head)
+{
+   return head->first ? queue_head_remove (head, head->first) : NULL ;
+}
+
+//------------------------------------------------------------------------------
+// Declara uma fila tipada name_t, de elementos do tipo type, com as operações
+// name_init, name_size, name_first, name_append, name_remove e name_pop.
+// O tipo deve começar pelos campos prev e next, nessa ordem, como queue_t;
+// isso é verificado em tempo de compilação. Ex.:
+//
+// QUEUE_DECLARE (taskqueue, task_t)   // taskqueue_t, taskqueue_append(), ...
+
+#define QUEUE_DECLARE(name, type)                                              \
+typedef struct { queue_head_t head ; } name##_t ;                              \
+_Static_assert (__builtin_offsetof (type, prev) == __builtin_offsetof (queue_t, prev) && \
+                __builtin_offsetof (type, next) == __builtin_offsetof (queue_t, next),   \
+                #type " deve comecar pelos campos prev e next") ;              \
+static inline void name##_init (name##_t *q)                                   \
+   { queue_head_init (&q->head) ; }                                            \
+static inline int name##_size (const name##_t *q)                              \
+   { return queue_head_size (&q->head) ; }                                     \
+static inline type *name##_first (const name##_t *q)                           \
+   { return (type *) q->head.first ; }                                         \
+static inline void name##_append (name##_t *q, type *elem)                     \
+   { queue_head_append (&q->head, (queue_t *) elem) ; }                        \
+static inline type *name##_remove (name##_t *q, type *elem)                    \
+   { return (type *) queue_head_remove (&q->head, (queue_t *) elem) ; }        \
+static inline type *name##_pop (name##_t *q)                                   \
+   { return (type *) queue_head_pop (&q->head) ; }
+
 #endif